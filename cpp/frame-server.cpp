@@ -0,0 +1,384 @@
+// Local frame server: owns one FFMPEGVideo reader per configured stream and
+// hands its frames to any number of clients over a Unix socket. Each frame
+// is written once into a sealed memfd whose descriptor goes to every client
+// via SCM_RIGHTS, so one (hardware) decode feeds all of them. Readers start
+// with their first client and stop with their last one.
+//
+//   frame-server [-s socket] [-W width] [-H height] [-f format] [-F filter]
+//                name=url [name=url ...]
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ffmpeg_video.h"
+#include "frame_server_protocol.h"
+
+static std::atomic<bool> stop_requested(false);
+
+static void handle_signal(int) { stop_requested = true; }
+
+struct Client {
+  explicit Client(int socket_fd)
+      : fd(socket_fd), max_inflight(0), inflight(0), dropped(0) {}
+  ~Client() { close(fd); }
+
+  int fd;
+  std::string stream; // Empty until subscribed
+  uint32_t max_inflight;
+  std::atomic<uint32_t> inflight; // Frames sent, not released yet
+  std::atomic<uint64_t> dropped;
+};
+
+// Writes the frame into a new memfd and seals it. Returns the fd, or -1.
+static int frame_to_memfd(const AVFrame *src, int size) {
+  int fd = memfd_create("frame", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0) {
+    return -1;
+  }
+  void *mem = MAP_FAILED;
+  if (ftruncate(fd, size) == 0) {
+    mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (mem == MAP_FAILED) {
+    close(fd);
+    return -1;
+  }
+  AVPixelFormat format = static_cast<AVPixelFormat>(src->format);
+  av_image_copy_to_buffer(static_cast<uint8_t *>(mem), size, src->data,
+                          src->linesize, format, src->width, src->height, 1);
+  munmap(mem, size);
+  // Clients can trust the frame not to change under them.
+  fcntl(fd, F_ADD_SEALS,
+        F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+  return fd;
+}
+
+// One source and its clients. The reader thread runs while there are
+// clients.
+class Stream {
+public:
+  Stream(const std::string &name, const std::string &url,
+         const std::string &filter_descr, const FFMPEGVideoOptions &options)
+      : name_(name), url_(url), filter_descr_(filter_descr),
+        options_(options), stopping_(false), running_(false), seq_(0) {}
+
+  ~Stream() { stop(); }
+
+  void Add(const std::shared_ptr<Client> &client) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    clients_.push_back(client);
+    stopping_ = false; // Keeps a stopping reader going
+    if (!running_) {
+      if (thread_.joinable()) {
+        thread_.join();
+      }
+      running_ = true;
+      thread_ = std::thread(&Stream::run, this);
+    }
+  }
+
+  void Remove(const std::shared_ptr<Client> &client) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < clients_.size(); i++) {
+      if (clients_[i] == client) {
+        clients_.erase(clients_.begin() + i);
+        break;
+      }
+    }
+    if (clients_.empty()) {
+      stopping_ = true;
+    }
+  }
+
+  void stop() {
+    stopping_ = true;
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+  }
+
+private:
+  const std::string name_;
+  const std::string url_;
+  const std::string filter_descr_;
+  const FFMPEGVideoOptions options_;
+
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<Client>> clients_;
+  std::thread thread_;
+  std::atomic<bool> stopping_;
+  bool running_; // Guarded by mutex_
+  uint64_t seq_;
+
+  void run() {
+    std::cout << "Stream " << name_ << ": opening " << url_ << std::endl;
+    FFMPEGVideo video(url_, filter_descr_, options_);
+    VideoFrame frame;
+    bool ended = !video.isInitialized();
+    std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+    for (;;) {
+      while (!ended && !stopping_) {
+        ended = !video.GetNextFrame(frame) || !publish(frame);
+      }
+      lock.lock();
+      if (ended || stopping_) {
+        break;
+      }
+      lock.unlock(); // A client subscribed while stopping
+    }
+
+    FrameServerMessage end;
+    memset(&end, 0, sizeof(end));
+    end.magic = kFrameServerMagic;
+    end.type = kFrameServerEnd;
+    end.seq = seq_;
+    for (const std::shared_ptr<Client> &client : clients_) {
+      SendFrameServerMessage(client->fd, &end, sizeof(end), -1, MSG_DONTWAIT);
+    }
+    clients_.clear(); // They disconnect on the end message
+    running_ = false;
+    std::cout << "Stream " << name_ << ": stopped after " << seq_
+              << " frames." << std::endl;
+  }
+
+  // Returns false when the frames cannot be served.
+  bool publish(const VideoFrame &frame) {
+    const AVFrame *src = frame.av.get();
+    AVPixelFormat format = static_cast<AVPixelFormat>(src->format);
+    int size = av_image_get_buffer_size(format, src->width, src->height, 1);
+    if (size <= 0 || src->hw_frames_ctx) {
+      std::cerr << "Stream " << name_ << ": frames need a software output "
+                << "format (set -f)." << std::endl;
+      return false;
+    }
+
+    FrameServerMessage message;
+    memset(&message, 0, sizeof(message));
+    message.magic = kFrameServerMagic;
+    message.type = kFrameServerFrame;
+    message.seq = ++seq_;
+    message.frame_id = frame.frame_id;
+    message.format = src->format;
+    message.width = src->width;
+    message.height = src->height;
+    message.pts = frame.pts;
+    message.time_seconds = frame.time_seconds;
+    message.size = size;
+
+    int fd = -1;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::shared_ptr<Client> &client : clients_) {
+      if (client->inflight >= client->max_inflight) {
+        client->dropped++;
+        continue;
+      }
+      // Written only once some client has room for it.
+      if (fd < 0 && (fd = frame_to_memfd(src, size)) < 0) {
+        std::cerr << "Stream " << name_ << ": memfd failed: "
+                  << strerror(errno) << std::endl;
+        return true;
+      }
+      if (SendFrameServerMessage(client->fd, &message, sizeof(message), fd,
+                                 MSG_DONTWAIT)) {
+        client->inflight++;
+      } else {
+        client->dropped++;
+      }
+    }
+    if (fd >= 0) {
+      close(fd); // The clients hold their own references
+    }
+    return true;
+  }
+};
+
+static int open_listen_socket(const std::string &path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    std::cerr << "Socket path too long: " << path << std::endl;
+    return -1;
+  }
+  memcpy(addr.sun_path, path.c_str(), path.size());
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  unlink(path.c_str()); // Stale socket of a previous run
+  if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) ||
+      listen(fd, 16)) {
+    std::cerr << "Failed to listen on " << path << ": " << strerror(errno)
+              << std::endl;
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Handles the subscription (first message) or a release of a client.
+// Returns false when the client should be dropped.
+static bool
+handle_client(const std::shared_ptr<Client> &client,
+              std::map<std::string, std::unique_ptr<Stream>> &streams) {
+  int fd;
+  if (!client->stream.empty()) {
+    FrameServerRelease release;
+    if (!ReceiveFrameServerMessage(client->fd, &release, sizeof(release),
+                                   fd) ||
+        release.magic != kFrameServerMagic) {
+      return false;
+    }
+    if (client->inflight > 0) {
+      client->inflight--;
+    }
+    return true;
+  }
+
+  FrameServerSubscribe subscribe;
+  if (!ReceiveFrameServerMessage(client->fd, &subscribe, sizeof(subscribe),
+                                 fd) ||
+      subscribe.magic != kFrameServerMagic ||
+      subscribe.version != kFrameServerVersion) {
+    return false;
+  }
+  subscribe.stream[kFrameServerStreamNameSize - 1] = '\0';
+  FrameServerMessage reply;
+  memset(&reply, 0, sizeof(reply));
+  reply.magic = kFrameServerMagic;
+  auto it = streams.find(subscribe.stream);
+  reply.type = it == streams.end() ? kFrameServerRejected
+                                   : kFrameServerAccepted;
+  if (!SendFrameServerMessage(client->fd, &reply, sizeof(reply), -1, 0) ||
+      it == streams.end()) {
+    return false;
+  }
+  client->stream = subscribe.stream;
+  client->max_inflight = std::max(subscribe.max_inflight, 1u);
+  it->second->Add(client);
+  std::cout << "Client subscribed to " << client->stream << std::endl;
+  return true;
+}
+
+int main(int argc, char **argv) {
+  std::string socket_path = "/tmp/frame-server.sock";
+  std::string filter_descr;
+  FFMPEGVideoOptions options;
+  options.out_format = "bgr24";
+  int opt;
+  while ((opt = getopt(argc, argv, "s:W:H:f:F:")) != -1) {
+    switch (opt) {
+    case 's':
+      socket_path = optarg;
+      break;
+    case 'W':
+      options.out_width = atoi(optarg);
+      break;
+    case 'H':
+      options.out_height = atoi(optarg);
+      break;
+    case 'f':
+      options.out_format = optarg;
+      break;
+    case 'F':
+      filter_descr = optarg;
+      options.out_format.clear();
+      break;
+    default:
+      std::cerr << "Usage: " << argv[0]
+                << " [-s socket] [-W width] [-H height] [-f format]"
+                   " [-F filter] name=url [name=url ...]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  std::map<std::string, std::unique_ptr<Stream>> streams;
+  for (int i = optind; i < argc; i++) {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    if (eq == std::string::npos || eq == 0) {
+      std::cerr << "Streams are given as name=url: " << arg << std::endl;
+      return 1;
+    }
+    std::string name = arg.substr(0, eq);
+    streams[name].reset(
+        new Stream(name, arg.substr(eq + 1), filter_descr, options));
+  }
+  if (streams.empty()) {
+    std::cerr << "No streams configured." << std::endl;
+    return 1;
+  }
+
+  int listen_fd = open_listen_socket(socket_path);
+  if (listen_fd < 0) {
+    return 1;
+  }
+  signal(SIGINT, handle_signal);
+  signal(SIGTERM, handle_signal);
+  signal(SIGPIPE, SIG_IGN);
+  std::cout << "Frame server listening on " << socket_path << " with "
+            << streams.size() << " streams." << std::endl;
+
+  std::vector<std::shared_ptr<Client>> clients;
+  std::vector<struct pollfd> pfds;
+  while (!stop_requested) {
+    pfds.assign(1, {listen_fd, POLLIN, 0});
+    for (const std::shared_ptr<Client> &client : clients) {
+      pfds.push_back({client->fd, POLLIN, 0});
+    }
+    if (poll(pfds.data(), pfds.size(), 200) <= 0) {
+      continue; // Timeout (checks stop_requested) or EINTR
+    }
+
+    // Clients first, the indices match until new ones are appended.
+    for (size_t i = clients.size(); i-- > 0;) {
+      if (!pfds[i + 1].revents) {
+        continue;
+      }
+      std::shared_ptr<Client> client = clients[i];
+      if ((pfds[i + 1].revents & POLLIN) && handle_client(client, streams)) {
+        continue;
+      }
+      if (!client->stream.empty()) {
+        streams[client->stream]->Remove(client);
+        std::cout << "Client left " << client->stream << " ("
+                  << client->dropped << " frames dropped)" << std::endl;
+      }
+      clients.erase(clients.begin() + i);
+    }
+    if (pfds[0].revents & POLLIN) {
+      int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+      if (fd >= 0) {
+        clients.push_back(std::make_shared<Client>(fd));
+      }
+    }
+  }
+
+  std::cout << "Shutting down." << std::endl;
+  for (auto &stream : streams) {
+    stream.second->stop();
+  }
+  clients.clear();
+  close(listen_fd);
+  unlink(socket_path.c_str());
+  return 0;
+}
@@ -1,3 +1,7 @@
 #!/bin/sh
 
 c++ -O3 ffmpeg-read.cpp -o ffmpeg-read -I/usr/include/ffmpeg -I/usr/include/opencv4 -fpermissive -lavcodec -lavutil -lavfilter -lavformat -lopencv_core -lopencv_highgui -lopencv_imgproc
+
+# Frame server, built on the reader of the Python module
+SRC=../python/src
+c++ -std=c++17 -O3 -pthread -I$SRC -I/usr/include/ffmpeg -I/usr/include/opencv4 frame-server.cpp $SRC/activity_scan.cpp $SRC/ffmpeg_video.cpp $SRC/frame_converter.cpp $SRC/frame_dedup.cpp $SRC/frame_ring.cpp $SRC/frame_stats.cpp $SRC/frame_server_protocol.cpp $SRC/session_governor.cpp $SRC/sws_converter.cpp $SRC/tensor_writer.cpp $SRC/yuv_converter.cpp -o frame-server -lavcodec -lavutil -lavfilter -lavformat -lswscale -lopencv_core -lopencv_imgproc -lrt
@@ -0,0 +1,50 @@
+import time
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+
+def decode(opts):
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+    if not cap.is_initialized():
+        print("Failed to initialize FFMPEGVideo.")
+        return 0, 0.0
+    start = time.time()
+    frames = 0
+    while cap.get_next_frame() is not None:
+        frames += 1
+    return frames, time.time() - start
+
+
+def main():
+    scan_opts = ffmpeg_video.ActivityScanOptions()
+    scan_opts.threshold = 2.0
+    start = time.time()
+    scan = ffmpeg_video.scan_activity(VIDEO_FILE, scan_opts)
+    if scan is None:
+        print("Activity scan failed.")
+        return
+    scan_time = time.time() - start
+    total = len(scan["pts"])
+    active = int(scan["active"].sum())
+    print(f"Scanned {total} frames in {scan_time:.1f}s, baseline packet "
+          f"{scan['baseline_size']:.0f} bytes, {active} frames active")
+    for (start_frame, end_frame), (t0, t1) in zip(scan["frame_ranges"],
+                                                  scan["time_ranges"]):
+        print(f"  frames [{start_frame}, {end_frame}) = {t0:.1f}s-{t1:.1f}s")
+
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.out_width, opts.out_height = 320, 180
+    opts.out_format = "gray"
+    frames, elapsed = decode(opts)
+    print(f"Full decode: {frames} frames in {elapsed:.1f}s")
+
+    opts.frame_ranges = scan["frame_ranges"]
+    frames, elapsed = decode(opts)
+    print(f"Active ranges only: {frames} frames in {elapsed:.1f}s")
+
+
+if __name__ == "__main__":
+    main()
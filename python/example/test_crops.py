@@ -0,0 +1,83 @@
+import time
+
+import cv2
+import numpy as np
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+CROP_SIZE = (224, 224)
+NUM_BOXES = 16
+NUM_FRAMES = 200
+# Largest per-pixel and mean difference from cv2 allowed: chroma siting and
+# rounding of the YUV to BGR step, plus the resize kernels (the crops are
+# resized from the YUV planes, the reference from the BGR frame).
+MAX_ABS_DIFF = 48
+MAX_MEAN_DIFF = 2.0
+
+
+def random_boxes(rng, width, height):
+    x1 = rng.integers(0, width - 64, NUM_BOXES)
+    y1 = rng.integers(0, height - 64, NUM_BOXES)
+    w = rng.integers(32, 320, NUM_BOXES)
+    h = rng.integers(32, 320, NUM_BOXES)
+    return np.stack([x1, y1, x1 + w, y1 + h], axis=1)
+
+
+def crops_cv2(frame, boxes):
+    """Reference: crop the full BGR frame and resize each box."""
+    return np.stack([
+        cv2.resize(frame[y1:y2, x1:x2], CROP_SIZE,
+                   interpolation=cv2.INTER_AREA)
+        for x1, y1, x2, y2 in boxes
+    ])
+
+
+def main():
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.out_width, opts.out_height = 640, 360
+    opts.out_format = "bgr24"
+    opts.keep_decoded = True
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+    if not cap.is_initialized():
+        print("Failed to initialize FFMPEGVideo.")
+        return
+
+    rng = np.random.default_rng(0)
+    width, height = cap.get_video_width(), cap.get_video_height()
+    frames = 0
+    crop_time = 0.0
+    while frames < NUM_FRAMES and cap.get_next_frame() is not None:
+        ref = cap.get_decoded_frame()
+        boxes = random_boxes(rng, width, height)
+        start = time.time()
+        crops = cap.get_crops(ref, boxes, CROP_SIZE)
+        crop_time += time.time() - start
+        frames += 1
+    print(f"get_crops: {crops.shape}, "
+          f"{1000 * crop_time / frames:.2f} ms per {NUM_BOXES} boxes")
+
+    # Compare with the full-frame BGR path on one frame.
+    full = ffmpeg_video.FFMPEGVideoOptions()
+    full.out_format = "bgr24"
+    full.keep_decoded = True
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", full)
+    frame = cap.get_next_frame()
+    boxes = random_boxes(rng, width, height)
+    boxes[:, :2] &= ~1
+    boxes[:, 2] = np.minimum(boxes[:, 2], width)
+    boxes[:, 3] = np.minimum(boxes[:, 3], height)
+    ours = cap.get_crops(cap.get_decoded_frame(), boxes, CROP_SIZE)
+    reference = crops_cv2(frame, boxes)
+    assert ours.shape == reference.shape, (ours.shape, reference.shape)
+    diff = np.abs(ours.astype(np.int16) - reference)
+    print(f"Difference to cv2 crops of the BGR frame: max {diff.max()}, "
+          f"mean {diff.mean():.2f}")
+    assert diff.max() <= MAX_ABS_DIFF, diff.max()
+    assert diff.mean() <= MAX_MEAN_DIFF, diff.mean()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,41 @@
+import time
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+
+def run(threshold):
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.out_width, opts.out_height = 640, 360
+    opts.out_format = "bgr24"
+    opts.dedup_threshold = threshold
+    opts.dedup_max_skip = 25
+
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+    if not cap.is_initialized():
+        print("Failed to initialize FFMPEGVideo.")
+        return
+    start = time.time()
+    frames = 0
+    scores = []
+    while cap.get_next_frame() is not None:
+        frames += 1
+        scores.append(cap.get_dedup_score())
+    elapsed = time.time() - start
+    print(f"threshold {threshold}: {frames} frames out in {elapsed:.1f}s, "
+          f"passed {cap.get_dedup_passed()}, dropped "
+          f"{cap.get_dedup_dropped()}")
+    if len(scores) > 1:
+        print(f"  scores of the frames passed: min {min(scores[1:]):.2f}, "
+              f"max {max(scores[1:]):.2f}")
+
+
+def main():
+    for threshold in (0.0, 0.5, 1.5, 3.0):
+        run(threshold)
+
+
+if __name__ == "__main__":
+    main()
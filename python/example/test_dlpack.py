@@ -0,0 +1,63 @@
+import time
+
+import numpy as np
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+NUM_FRAMES = 200
+
+
+def open_video():
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.out_width, opts.out_height = 640, 640
+    opts.out_format = "rgb24"
+    opts.tensor_layout = "chw"
+    opts.tensor_dtype = "float32"
+    opts.tensor_scale = [1 / 255.0]
+    return ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+
+
+def main():
+    try:
+        import torch
+    except ImportError:
+        torch = None
+
+    cap = open_video()
+    if not cap.is_initialized():
+        print("Failed to initialize FFMPEGVideo.")
+        return
+
+    ref = cap.get_next_frame_ref()
+    print(f"FrameRef {ref.width}x{ref.height} {ref.format}, "
+          f"device {ref.__dlpack_device__()}")
+    array = np.from_dlpack(ref)
+    assert np.shares_memory(array, ref.numpy())
+    print(f"np.from_dlpack: {array.shape} {array.dtype}, no copy")
+
+    if torch is None:
+        print("PyTorch not installed, skipping torch.from_dlpack.")
+        return
+
+    frames = 0
+    start = time.time()
+    while frames < NUM_FRAMES:
+        ref = cap.get_next_frame_ref()
+        if ref is None:
+            break
+        image = torch.from_dlpack(ref).permute(2, 0, 1)
+        frames += 1
+    print(f"torch.from_dlpack: {tuple(image.shape)}, "
+          f"{frames / (time.time() - start):7.1f} fps")
+
+    batch = cap.get_next_batch(8)
+    tensor = torch.from_dlpack(batch)
+    assert tensor.data_ptr() == batch.ctypes.data
+    print(f"Batch shared with torch: {tuple(tensor.shape)} {tensor.dtype}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,39 @@
+import time
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+# CPU fallback of scale_rkrga, the hot spot at 2880x1616
+SW_FILTER_DESCR = "scale=w=1280:h=720,format=bgr24"
+
+NUM_FRAMES = 200
+
+
+def run(threads):
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.force_software = True
+    opts.filter_threads = threads
+    opts.sws_threads = threads
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, SW_FILTER_DESCR, opts)
+    if not cap.is_initialized():
+        print("Failed to initialize FFMPEGVideo. Exiting.")
+        return
+
+    frames = 0
+    start = time.time()
+    while frames < NUM_FRAMES and cap.get_next_frame() is not None:
+        frames += 1
+    elapsed = time.time() - start
+    print(f"{threads} thread(s): {frames / elapsed:7.1f} fps, "
+          f"filter stage {cap.get_filter_time_ms():6.2f} ms/frame")
+
+
+def main():
+    for threads in (1, 2, 4, 8):
+        run(threads)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,45 @@
+import sys
+import time
+
+import ffmpeg_video
+
+# Start the server first, e.g.:
+#   cpp/frame-server -s /tmp/frame-server.sock -f bgr24 cam1=<url>
+SOCKET_PATH = "/tmp/frame-server.sock"
+STREAM = sys.argv[1] if len(sys.argv) > 1 else "cam1"
+NUM_FRAMES = 300
+
+
+def main():
+    client = ffmpeg_video.FrameClient(SOCKET_PATH, STREAM, max_inflight=4)
+    if not client.is_connected():
+        print(f"Failed to subscribe to {STREAM} on {SOCKET_PATH}.")
+        return
+
+    frames = 0
+    last_seq = 0
+    skipped = 0
+    start = time.time()
+    while frames < NUM_FRAMES:
+        result = client.read(timeout_ms=5000)
+        if result is None:
+            print("Stream ended." if client.is_ended() else "Timeout.")
+            break
+        frame, info = result
+        if last_seq:
+            skipped += info["seq"] - last_seq - 1
+        last_seq = info["seq"]
+        if frames == 0:
+            planes = frame if isinstance(frame, tuple) else (frame,)
+            print(f"First frame {info['frame_id']}: "
+                  f"{[plane.shape for plane in planes]}, "
+                  f"writeable={planes[0].flags.writeable}")
+        frames += 1
+    elapsed = time.time() - start
+    print(f"{frames} frames in {elapsed:.1f}s ({frames / elapsed:.1f} fps), "
+          f"{skipped} dropped by the server")
+    client.close()
+
+
+if __name__ == "__main__":
+    main()
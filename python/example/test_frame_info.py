@@ -0,0 +1,54 @@
+import time
+
+import numpy as np
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+MOTION_THRESHOLD = 0.5
+
+
+def main():
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.out_width, opts.out_height = 640, 360
+    opts.out_format = "bgr24"
+    opts.export_side_data = True
+    opts.force_software = True  # Motion vectors and QP need it
+
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+    if not cap.is_initialized():
+        print("Failed to initialize FFMPEGVideo.")
+        return
+
+    # Per frame info with the converted frame.
+    for _ in range(5):
+        result = cap.get_next_frame_with_info()
+        if result is None:
+            break
+        frame, info = result
+        mvs = info["motion_vectors"]
+        print(f"{info['pict_type']} key={info['key_frame']} "
+              f"size={info['packet_size']} qp={info['qp_mean']:.1f} "
+              f"motion={info['motion']:.2f} vectors={len(mvs)}")
+        if len(mvs):
+            moving = np.abs(mvs["motion_x"]) + np.abs(mvs["motion_y"]) > 0
+            print(f"  {int(moving.sum())} moving blocks")
+
+    # Decode everything, convert only I frames and frames with motion.
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+    start = time.time()
+    decoded = converted = 0
+    while (result := cap.decode_next_frame()) is not None:
+        ref, info = result
+        decoded += 1
+        if info["pict_type"] == "I" or info["motion"] > MOTION_THRESHOLD:
+            if cap.filter_frame(ref) is not None:
+                converted += 1
+    print(f"Decoded {decoded} frames, converted {converted} in "
+          f"{time.time() - start:.1f}s")
+
+
+if __name__ == "__main__":
+    main()
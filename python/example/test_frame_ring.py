@@ -0,0 +1,73 @@
+import multiprocessing
+import time
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+RING_NAME = "ffmpeg_video_test_ring"
+NUM_FRAMES = 300
+NUM_CONSUMERS = 3
+
+
+def producer(ready):
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.out_width, opts.out_height = 640, 360
+    opts.out_format = "bgr24"
+    opts.shm_ring_name = RING_NAME
+    opts.shm_ring_slots = 8
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+    if not cap.is_initialized():
+        print("Failed to initialize FFMPEGVideo.")
+        ready.set()
+        return
+    cap.get_next_frame()  # Creates the ring
+    ready.set()
+    time.sleep(0.5)  # Let the consumers map the ring
+    frames = 1
+    while frames < NUM_FRAMES and cap.get_next_frame() is not None:
+        frames += 1
+        time.sleep(0.01)
+    print(f"Producer wrote {frames} frames")
+    # The ring is closed (and its name removed) with the reader.
+
+
+def consumer(index):
+    ring = ffmpeg_video.FrameRingReader(RING_NAME)
+    if not ring.is_open():
+        print(f"Consumer {index}: failed to open the ring.")
+        return
+    frames = 0
+    mean = 0.0
+    while True:
+        result = ring.read(timeout_ms=2000)
+        if result is None:
+            break
+        frame, info = result
+        mean += frame[::8, ::8].mean()
+        if not ring.is_current(info["seq"]):
+            print(f"Consumer {index}: frame {info['seq']} was overwritten")
+        frames += 1
+    print(f"Consumer {index}: {frames} frames, {ring.get_dropped()} dropped, "
+          f"average mean {mean / max(frames, 1):.1f}")
+
+
+def main():
+    ready = multiprocessing.Event()
+    writer = multiprocessing.Process(target=producer, args=(ready,))
+    writer.start()
+    ready.wait()
+    readers = [
+        multiprocessing.Process(target=consumer, args=(i,))
+        for i in range(NUM_CONSUMERS)
+    ]
+    for reader in readers:
+        reader.start()
+    writer.join()
+    for reader in readers:
+        reader.join()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,51 @@
+import time
+
+import cv2
+import numpy as np
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+
+def main():
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.out_format = "gray"
+    opts.compute_stats = True
+    opts.stats_bins = 16
+
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+    if not cap.is_initialized():
+        print("Failed to initialize FFMPEGVideo.")
+        return
+
+    # Compare with the same stats computed in Python.
+    for _ in range(5):
+        frame = cap.get_next_frame()
+        if frame is None:
+            break
+        stats = cap.get_last_frame_stats()
+        lap = cv2.Laplacian(frame, cv2.CV_32F, ksize=1)
+        print(f"mean {stats['mean']:.2f} ({frame.mean():.2f}), stddev "
+              f"{stats['stddev']:.2f} ({frame.std():.2f}), laplacian_var "
+              f"{stats['laplacian_var']:.1f} ({lap[1:-1, 1:-1].var():.1f})")
+        print(f"  histogram {stats['histogram']}")
+
+    # Gate on the stats: dark and blurry frames never get converted.
+    opts.out_format = "bgr24"
+    opts.min_mean_luma = 20
+    opts.min_laplacian_var = 50
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+    start = time.time()
+    frames = 0
+    means = []
+    while cap.get_next_frame() is not None:
+        frames += 1
+        means.append(cap.get_last_frame_stats()["mean"])
+    print(f"{frames} frames passed, {cap.get_stats_dropped()} dropped in "
+          f"{time.time() - start:.1f}s, mean luma {np.mean(means):.1f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,48 @@
+import time
+
+import ffmpeg_video
+
+# Local files stand in for the cameras. realtime=True paces each file by its
+# timestamps and the manager reopens it on EOF, like a reconnecting camera.
+# A network stand-in works too, e.g.:
+#   ffmpeg -re -stream_loop -1 -i H121643.asf -c copy -f mpegts udp://127.0.0.1:5000
+# then add_camera("udp0", "udp://127.0.0.1:5000", ..., options) with
+# options.nonblocking = True.
+VIDEO_FILES = [
+    "/data/video/1/2025/06/24/H121643.asf",
+    "/data/video/1/2025/06/27/H124841.asf",
+]
+NUM_CAMERAS = 16
+
+CUSTOM_FILTER_DESCR = "scale_rkrga=w=640:h=360:format=bgr24,hwmap=mode=read,format=bgr24"
+
+
+def main():
+    manager = ffmpeg_video.IngestManager(num_threads=4)
+    for i in range(NUM_CAMERAS):
+        manager.add_camera(f"cam{i:02d}", VIDEO_FILES[i % len(VIDEO_FILES)],
+                           CUSTOM_FILTER_DESCR, realtime=True)
+    manager.start()
+
+    try:
+        while True:
+            time.sleep(2.0)
+            print(f"{'camera':<8} {'up':<3} {'fps':>6} {'lat ms':>8} "
+                  f"{'decoded':>8} {'skipped':>8} {'reconn':>6}")
+            for row in manager.get_stats():
+                print(f"{row['cam_id']:<8} {'y' if row['connected'] else 'n':<3} "
+                      f"{row['fps']:>6.1f} {row['latency_avg_ms']:>8.1f} "
+                      f"{row['frames_decoded']:>8} {row['frames_skipped']:>8} "
+                      f"{row['reconnects']:>6}")
+
+            np_frame = manager.latest("cam00")
+            if np_frame is not None:
+                print(f"cam00 latest frame: {np_frame.shape}")
+    except KeyboardInterrupt:
+        pass
+    finally:
+        manager.stop()
+
+
+if __name__ == "__main__":
+    main()
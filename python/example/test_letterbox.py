@@ -0,0 +1,71 @@
+import time
+
+import cv2
+import numpy as np
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+SIZE = 640
+PAD = 114
+NUM_FRAMES = 200
+
+
+def letterbox_cv2(frame):
+    """Reference letterbox with OpenCV (resize + copyMakeBorder)."""
+    h, w = frame.shape[:2]
+    scale = min(SIZE / w, SIZE / h)
+    nw, nh = round(w * scale), round(h * scale)
+    resized = cv2.resize(frame, (nw, nh), interpolation=cv2.INTER_AREA)
+    top, left = (SIZE - nh) // 2, (SIZE - nw) // 2
+    return cv2.copyMakeBorder(resized, top, SIZE - nh - top, left,
+                              SIZE - nw - left, cv2.BORDER_CONSTANT,
+                              value=(PAD, PAD, PAD))
+
+
+def run_native(converter):
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.converter = converter
+    opts.out_format = "bgr24"
+    opts.letterbox_width = SIZE
+    opts.letterbox_height = SIZE
+    opts.letterbox_pad = PAD
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+    if not cap.is_initialized():
+        print(f"Failed to initialize FFMPEGVideo with converter {converter}.")
+        return
+    frame, transform = cap.get_next_letterboxed()
+    print(f"{converter}: {frame.shape}, transform {transform}")
+
+    frames = 1
+    start = time.time()
+    while frames < NUM_FRAMES and cap.get_next_frame() is not None:
+        frames += 1
+    print(f"  {frames / (time.time() - start):7.1f} fps")
+
+
+def run_cv2():
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.out_format = "bgr24"
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+    frames = 0
+    start = time.time()
+    while frames < NUM_FRAMES:
+        frame = cap.get_next_frame()
+        if frame is None:
+            break
+        letterbox_cv2(frame)
+        frames += 1
+    print(f"cv2 letterbox: {frames / (time.time() - start):7.1f} fps")
+
+
+def main():
+    for converter in ("swscale", "simd"):
+        run_native(converter)
+    run_cv2()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,47 @@
+import time
+
+import ffmpeg_video
+
+# Define the path to your video file
+# The file is fed at real-time pace, as if it came from a live camera
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+CUSTOM_FILTER_DESCR = "scale_rkrga=w=640:h=360:format=bgr24,hwmap=mode=read,format=bgr24"
+
+# Simulated detector cost per frame (slower than the 5 fps input on purpose)
+DETECTOR_SECONDS = 0.3
+
+
+def main():
+    print(f"Attempting to initialize LiveVideo with: {VIDEO_FILE}")
+    live = ffmpeg_video.LiveVideo(VIDEO_FILE, CUSTOM_FILTER_DESCR, realtime=True)
+    if not live.is_initialized():
+        print("Failed to initialize LiveVideo. Exiting.")
+        return
+
+    live.start()
+    try:
+        while True:
+            np_frame = live.get_latest_frame(timeout_ms=2000)
+            if np_frame is None:
+                print("End of stream or timeout, no more frames.")
+                break
+
+            stats = live.get_stats()
+            print(f"Frame {np_frame.shape[1]}x{np_frame.shape[0]} "
+                  f"latency: {stats['latency_last_ms']:.1f}ms "
+                  f"(avg {stats['latency_avg_ms']:.1f}ms, "
+                  f"max {stats['latency_max_ms']:.1f}ms) "
+                  f"superseded: {stats['frames_superseded']}")
+
+            time.sleep(DETECTOR_SECONDS)
+    finally:
+        live.stop()
+
+    stats = live.get_stats()
+    print(f"Decoded {stats['frames_decoded']}, delivered {stats['frames_delivered']}, "
+          f"skipped conversion for {stats['frames_superseded']} frames.")
+
+
+if __name__ == "__main__":
+    main()
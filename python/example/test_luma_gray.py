@@ -0,0 +1,58 @@
+import time
+
+import numpy as np
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+NUM_FRAMES = 300
+# Largest per-pixel difference from swscale allowed: the luma plane itself
+# at the source size, area against bilinear sampling when scaling.
+MAX_ABS_DIFF = {(0, 0): 1, (-2, 360): 16}
+
+
+def run(converter, width, height):
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.converter = converter
+    opts.out_width = width
+    opts.out_height = height
+    opts.out_format = "gray"
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+    if not cap.is_initialized():
+        print(f"Failed to initialize FFMPEGVideo with converter {converter}.")
+        return None
+
+    frames = 0
+    last = None
+    start = time.time()
+    while frames < NUM_FRAMES:
+        frame = cap.get_next_frame()
+        if frame is None:
+            break
+        if frames == 0:
+            last = frame.copy()
+        frames += 1
+    elapsed = time.time() - start
+    print(f"{cap.get_converter_name():8s} {width}x{height}: "
+          f"{frames / elapsed:7.1f} fps, "
+          f"conversion {cap.get_filter_time_ms():6.2f} ms/frame")
+    return last
+
+
+def main():
+    # 0 x 0 keeps the source size (zero-copy luma)
+    for width, height in ((0, 0), (-2, 360)):
+        luma = run("luma", width, height)
+        sws = run("swscale", width, height)
+        assert luma is not None and sws is not None
+        assert luma.shape == sws.shape, (luma.shape, sws.shape)
+        diff = np.abs(luma.astype(np.int16) - sws.astype(np.int16))
+        print(f"  first frame: max abs diff {diff.max()}, "
+              f"mean {diff.mean():.2f}")
+        assert diff.max() <= MAX_ABS_DIFF[(width, height)], diff.max()
+
+
+if __name__ == "__main__":
+    main()
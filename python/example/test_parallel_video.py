@@ -0,0 +1,51 @@
+import time
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+NUM_WORKERS = 4
+
+
+def main():
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.out_width, opts.out_height = 320, 180
+    opts.out_format = "gray"
+
+    # Baseline: one pipeline.
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+    if not cap.is_initialized():
+        print("Failed to initialize FFMPEGVideo.")
+        return
+    start = time.time()
+    serial = []
+    while (frame := cap.get_next_frame()) is not None:
+        serial.append(int(frame.sum()))
+    serial_time = time.time() - start
+
+    pcap = ffmpeg_video.ParallelVideo(VIDEO_FILE, "", opts,
+                                      workers=NUM_WORKERS)
+    if not pcap.is_initialized():
+        print("Failed to initialize ParallelVideo.")
+        return
+    print(f"{pcap.get_frame_total()} frames in {pcap.get_chunks()} chunks, "
+          f"{pcap.get_workers()} workers")
+    start = time.time()
+    parallel = []
+    while (frame := pcap.get_next_frame()) is not None:
+        parallel.append(int(frame.sum()))
+    parallel_time = time.time() - start
+
+    print(f"Serial: {len(serial)} frames in {serial_time:.1f}s")
+    print(f"Parallel: {len(parallel)} frames in {parallel_time:.1f}s, "
+          f"peak buffered {pcap.get_max_buffered()}, failed chunks "
+          f"{pcap.get_failed_chunks()}")
+    assert pcap.get_failed_chunks() == 0, pcap.get_failed_chunks()
+    assert len(parallel) == len(serial), (len(parallel), len(serial))
+    assert parallel == serial, "Frames differ or are out of order"
+    print("Same frames in the same order")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,67 @@
+import bisect
+import time
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+
+def read_all(opts):
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+    assert cap.is_initialized(), "Failed to initialize FFMPEGVideo."
+    start = time.time()
+    samples = []
+    while cap.get_next_frame() is not None:
+        samples.append((cap.get_frame_id() - 1,
+                        cap.get_last_frame_time_seconds()))
+    print(f"  {len(samples)} frames in {time.time() - start:.2f}s")
+    return samples
+
+
+def main():
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.out_format = "bgr24"
+
+    print("All frames:")
+    frames = read_all(opts)
+    times = [t for _, t in frames]
+
+    print("Every 25th frame:")
+    opts.sample_every_n = 25
+    samples = read_all(opts)
+    print(f"  {samples[:5]}")
+    assert [i for i, _ in samples] == list(range(0, len(frames), 25))
+
+    print("1 frame per second:")
+    opts.sample_every_n = 0
+    opts.sample_target_fps = 1.0
+    samples = read_all(opts)
+    print(f"  {samples[:5]}")
+    seconds = [int(t + 1e-6) for _, t in samples]
+    assert len(set(seconds)) == len(seconds), "More than one frame a second"
+    assert set(seconds) == {int(t + 1e-6) for t in times}, "Missed a second"
+
+    print("Timestamps:")
+    opts.sample_target_fps = 0.0
+    start = times[0]
+    opts.sample_timestamps = [start, start + 2.5, start + 10.0,
+                              start + 60.0, start + 61.0]
+    samples = read_all(opts)
+    print(f"  {samples}")
+    # The first frame at or after each timestamp, once.
+    expected = []
+    for t in opts.sample_timestamps:
+        i = bisect.bisect_left(times, t - 1e-6)
+        if i < len(frames) and frames[i][0] not in expected:
+            expected.append(frames[i][0])
+    assert [i for i, _ in samples] == expected
+
+    # Invalid sampling options are rejected.
+    opts.sample_timestamps = [10.0, 5.0]
+    assert not ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts).is_initialized()
+    print("OK")
+
+
+if __name__ == "__main__":
+    main()
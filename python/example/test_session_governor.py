@@ -0,0 +1,55 @@
+import threading
+import time
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+# Software decode path, so the governor can be exercised without MPP
+SW_FILTER_DESCR = "scale=w=320:h=180,format=bgr24"
+
+NUM_READERS = 4
+MAX_SESSIONS = 2
+
+
+def reader(idx, results):
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.force_software = True
+    opts.session_priority = idx
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, SW_FILTER_DESCR, opts)
+    if not cap.is_initialized():
+        results[idx] = "failed to open"
+        return
+
+    frames = 0
+    while frames < 50 and cap.get_next_frame() is not None:
+        frames += 1
+    results[idx] = (f"{frames} frames with {cap.get_decoder_name()}, "
+                    f"waited {cap.get_session_wait_ms():.0f}ms")
+    del cap  # Returns the session to the next reader
+
+
+def main():
+    # Artificial cap on the software path, readers beyond it queue up
+    ffmpeg_video.configure_sessions(MAX_SESSIONS,
+                                    ffmpeg_video.SessionQueuePolicy.PRIORITY,
+                                    govern_software=True)
+
+    results = {}
+    threads = [threading.Thread(target=reader, args=(i, results))
+               for i in range(NUM_READERS)]
+    start = time.time()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    for idx in sorted(results):
+        print(f"Reader {idx}: {results[idx]}")
+    print(f"Done in {time.time() - start:.2f}s")
+    print(ffmpeg_video.get_session_stats())
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,74 @@
+import multiprocessing
+import pickle
+import time
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+NUM_WORKERS = 4
+
+
+def open_video():
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.out_width, opts.out_height = 320, 180
+    opts.out_format = "gray"
+    return ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+
+
+def decode_shard(args):
+    cap, k, n = args  # cap arrives pickled
+    start, end = cap.shard(k, n)
+    frames = 0
+    first_pts = None
+    while cap.get_next_frame() is not None:
+        if first_pts is None:
+            first_pts = cap.get_last_frame_pts()
+        frames += 1
+    return k, start, end, frames, first_pts
+
+
+def main():
+    cap = open_video()
+    if not cap.is_initialized():
+        print("Failed to initialize FFMPEGVideo.")
+        return
+
+    keyframes = cap.get_keyframes()
+    print(f"{len(keyframes)} keyframes, {cap.get_frame_total()} frames")
+    print(f"Shards: {cap.get_shard_bounds(NUM_WORKERS)}")
+
+    # Pickle round trip keeps the position.
+    for _ in range(10):
+        cap.get_next_frame()
+    clone = pickle.loads(pickle.dumps(cap))
+    cap.get_next_frame()
+    clone.get_next_frame()
+    print(f"Original at frame {cap.get_frame_id()} pts "
+          f"{cap.get_last_frame_pts()}, clone at frame {clone.get_frame_id()} "
+          f"pts {clone.get_last_frame_pts()}")
+    assert clone.get_frame_id() == cap.get_frame_id()
+    assert clone.get_last_frame_pts() == cap.get_last_frame_pts()
+
+    start = time.time()
+    with multiprocessing.Pool(NUM_WORKERS) as pool:
+        jobs = [(open_video(), k, NUM_WORKERS) for k in range(NUM_WORKERS)]
+        results = pool.map(decode_shard, jobs)
+    elapsed = time.time() - start
+    total = 0
+    next_start = 0
+    for k, start_frame, end_frame, frames, first_pts in sorted(results):
+        print(f"Shard {k}: [{start_frame}, {end_frame}) decoded {frames} "
+              f"frames, first pts {first_pts}")
+        # Back to back from frame 0, no gap and no overlap.
+        assert start_frame == next_start, (k, start_frame, next_start)
+        assert frames == end_frame - start_frame, (k, frames)
+        next_start = end_frame
+        total += frames
+    assert next_start == cap.get_frame_total(), next_start
+    print(f"{total} frames in {elapsed:.1f}s with {NUM_WORKERS} workers")
+
+
+if __name__ == "__main__":
+    main()
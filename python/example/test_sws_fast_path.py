@@ -0,0 +1,42 @@
+import time
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+# Plain resize + convert, eligible for the swscale fast path
+FILTER_DESCR = "scale=w=1280:h=720,format=bgr24"
+
+NUM_FRAMES = 300
+
+
+def run(converter, threads):
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.force_software = True
+    opts.converter = converter
+    opts.filter_threads = threads
+    opts.sws_threads = threads
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, FILTER_DESCR, opts)
+    if not cap.is_initialized():
+        print(f"Failed to initialize FFMPEGVideo with converter {converter}.")
+        return
+
+    frames = 0
+    start = time.time()
+    while frames < NUM_FRAMES and cap.get_next_frame() is not None:
+        frames += 1
+    elapsed = time.time() - start
+    print(f"{cap.get_converter_name():8s} {threads} thread(s): "
+          f"{frames / elapsed:7.1f} fps, "
+          f"conversion {cap.get_filter_time_ms():6.2f} ms/frame")
+
+
+def main():
+    for threads in (1, 4):
+        run("avfilter", threads)
+        run("swscale", threads)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,90 @@
+import time
+
+import numpy as np
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+MEAN = [123.675, 116.28, 103.53]
+STD = [58.395, 57.12, 57.375]
+
+NUM_BATCHES = 20
+BATCH_SIZE = 8
+
+
+def open_video(dtype="float32"):
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.out_width = 640
+    opts.out_height = 640
+    opts.out_format = "bgr24"
+    opts.tensor_layout = "chw"
+    opts.tensor_channel_order = "rgb"
+    opts.tensor_dtype = dtype
+    opts.tensor_mean = MEAN
+    opts.tensor_scale = [1.0 / s for s in STD]
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+    if not cap.is_initialized():
+        raise RuntimeError("Failed to initialize FFMPEGVideo.")
+    return cap
+
+
+def check():
+    """Native tensor against the same normalization done in NumPy."""
+    reference = open_video()
+    native = open_video()
+    bgr = reference.get_next_frame()
+    expected = (bgr[:, :, ::-1].astype(np.float32) - MEAN) / STD
+    expected = expected.transpose(2, 0, 1)
+    tensor = native.get_next_tensor()
+    max_diff = np.abs(tensor - expected).max()
+    print(f"tensor {tensor.shape} {tensor.dtype}, max abs diff {max_diff:.2e}")
+    assert tensor.shape == expected.shape, (tensor.shape, expected.shape)
+    # Same arithmetic, up to float32 rounding of the scale.
+    assert max_diff <= 1e-4, max_diff
+
+
+def benchmark(dtype):
+    cap = open_video(dtype)
+    frames = 0
+    start = time.time()
+    for _ in range(NUM_BATCHES):
+        batch = cap.get_next_batch(BATCH_SIZE)
+        if batch is None:
+            break
+        frames += batch.shape[0]
+    elapsed = time.time() - start
+    print(f"native {dtype:8s}: {frames / elapsed:7.1f} fps")
+
+
+def benchmark_numpy():
+    cap = open_video()
+    frames = 0
+    start = time.time()
+    for _ in range(NUM_BATCHES):
+        batch = []
+        for _ in range(BATCH_SIZE):
+            bgr = cap.get_next_frame()
+            if bgr is None:
+                break
+            chw = bgr[:, :, ::-1].transpose(2, 0, 1).astype(np.float32)
+            batch.append((chw - np.reshape(MEAN, (3, 1, 1)))
+                         / np.reshape(STD, (3, 1, 1)))
+        if not batch:
+            break
+        np.stack(batch)
+        frames += len(batch)
+    elapsed = time.time() - start
+    print(f"numpy float32  : {frames / elapsed:7.1f} fps")
+
+
+def main():
+    check()
+    for dtype in ("uint8", "float16", "float32"):
+        benchmark(dtype)
+    benchmark_numpy()
+
+
+if __name__ == "__main__":
+    main()
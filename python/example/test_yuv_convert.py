@@ -0,0 +1,76 @@
+import time
+
+import numpy as np
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+NUM_FRAMES = 200
+# Largest per-pixel difference from swscale allowed, by (width, height):
+# chroma siting and rounding at the source size, plus the resize kernels
+# (area against swscale's bilinear) when scaling.
+MAX_ABS_DIFF = {(0, 0): 16, (640, 360): 48}
+MAX_MEAN_DIFF = 2.0
+
+
+def open_video(converter, width, height, resize_filter="area"):
+    opts = ffmpeg_video.FFMPEGVideoOptions()
+    opts.force_software = True
+    opts.converter = converter
+    opts.out_width = width
+    opts.out_height = height
+    opts.out_format = "bgr24"
+    opts.resize_filter = resize_filter
+    cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+    if not cap.is_initialized():
+        raise RuntimeError(f"Failed to initialize converter {converter}.")
+    return cap
+
+
+def compare(width, height):
+    """simd output against swscale, frame by frame."""
+    simd = open_video("simd", width, height)
+    sws = open_video("swscale", width, height)
+    max_diff = 0
+    mean_diff = []
+    for _ in range(20):
+        a = simd.get_next_frame()
+        b = sws.get_next_frame()
+        if a is None or b is None:
+            break
+        diff = np.abs(a.astype(np.int16) - b.astype(np.int16))
+        max_diff = max(max_diff, int(diff.max()))
+        mean_diff.append(diff.mean())
+    print(f"{width}x{height}: mean abs diff {np.mean(mean_diff):.2f}, "
+          f"max abs diff {max_diff}")
+    assert mean_diff, "No frames compared"
+    assert max_diff <= MAX_ABS_DIFF[(width, height)], max_diff
+    assert np.mean(mean_diff) <= MAX_MEAN_DIFF, np.mean(mean_diff)
+
+
+def benchmark(converter, width, height, resize_filter="area"):
+    cap = open_video(converter, width, height, resize_filter)
+    frames = 0
+    start = time.time()
+    while frames < NUM_FRAMES and cap.get_next_frame() is not None:
+        frames += 1
+    elapsed = time.time() - start
+    name = converter if converter != "simd" else f"simd/{resize_filter}"
+    print(f"{name:14s} {width}x{height}: {frames / elapsed:7.1f} fps, "
+          f"conversion {cap.get_filter_time_ms():6.2f} ms/frame")
+
+
+def main():
+    print(f"simd kernel: {ffmpeg_video.get_simd_kernel()}")
+    # 0 x 0 keeps the source size (no resize, conversion only)
+    for width, height in ((0, 0), (640, 360)):
+        compare(width, height)
+        benchmark("swscale", width, height)
+        benchmark("simd", width, height)
+        benchmark("simd", width, height, "bilinear")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,42 @@
+import cv2
+import numpy as np
+
+import ffmpeg_video
+
+# Define the path to your video file
+VIDEO_FILE = "/data/video/1/2025/06/24/H121643.asf"
+
+
+def main():
+    for out_format in ("nv12", "yuv420p"):
+        opts = ffmpeg_video.FFMPEGVideoOptions()
+        opts.out_format = out_format
+        cap = ffmpeg_video.FFMPEGVideo(VIDEO_FILE, "", opts)
+        if not cap.is_initialized():
+            print(f"Failed to initialize FFMPEGVideo for {out_format}.")
+            continue
+
+        planes = cap.get_next_frame()
+        if planes is None:
+            print("No frame.")
+            continue
+        print(f"{out_format} via {cap.get_converter_name()}: "
+              + ", ".join(str(p.shape) for p in planes))
+
+        # Repack into OpenCV's single array layout and convert for display.
+        y = planes[0]
+        h, w = y.shape
+        if out_format == "nv12":
+            uv = planes[1].reshape(planes[1].shape[0], -1)[:, :w]
+            packed = np.vstack([y, uv])
+            bgr = cv2.cvtColor(packed, cv2.COLOR_YUV2BGR_NV12)
+        else:
+            u = planes[1].reshape(-1, w)
+            v = planes[2].reshape(-1, w)
+            packed = np.vstack([y, u, v])
+            bgr = cv2.cvtColor(packed, cv2.COLOR_YUV2BGR_I420)
+        print(f"  repacked {packed.shape} -> bgr {bgr.shape}")
+
+
+if __name__ == "__main__":
+    main()
@@ -16,12 +16,30 @@ except ImportError:
     print("pybind11 not found. Please install it: pip install pybind11", file=sys.stderr)
     sys.exit(1)
 
-CXX_FLAGS = ['-std=c++17', '-O3', '-D_GNU_SOURCE', '-D_POSIX_C_SOURCE=200809L']
+CXX_FLAGS = ['-std=c++17', '-O3', '-pthread', '-D_GNU_SOURCE', '-D_POSIX_C_SOURCE=200809L']
 
 ext_modules = [
     Extension(
         'ffmpeg_video',
-        sources=[os.path.join('src', 'ffmpeg_video.cpp'), os.path.join('src', 'bindings.cpp')], 
+        sources=[
+            os.path.join('src', 'activity_scan.cpp'),
+            os.path.join('src', 'ffmpeg_video.cpp'),
+            os.path.join('src', 'frame_converter.cpp'),
+            os.path.join('src', 'frame_dedup.cpp'),
+            os.path.join('src', 'frame_broadcaster.cpp'),
+            os.path.join('src', 'frame_client.cpp'),
+            os.path.join('src', 'frame_ring.cpp'),
+            os.path.join('src', 'frame_stats.cpp'),
+            os.path.join('src', 'frame_server_protocol.cpp'),
+            os.path.join('src', 'ingest_manager.cpp'),
+            os.path.join('src', 'live_video.cpp'),
+            os.path.join('src', 'parallel_video.cpp'),
+            os.path.join('src', 'session_governor.cpp'),
+            os.path.join('src', 'sws_converter.cpp'),
+            os.path.join('src', 'tensor_writer.cpp'),
+            os.path.join('src', 'yuv_converter.cpp'),
+            os.path.join('src', 'bindings.cpp'),
+        ],
         include_dirs=[
             PYBIND11_INCLUDE_DIR,
             FFMPEG_INCLUDE_DIR,
@@ -37,12 +55,14 @@ ext_modules = [
             'avcodec',
             'avutil',
             'avfilter',
+            'swscale',
             'opencv_core',
             'opencv_highgui',
             'opencv_imgproc',
+            'rt',
         ],
         extra_compile_args=CXX_FLAGS,
-        extra_link_args=[],
+        extra_link_args=['-pthread'],
         language='c++'
     ),
 ]
@@ -0,0 +1,270 @@
+#include "activity_scan.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <iostream>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/motion_vector.h>
+}
+
+#include "av_error.h"
+
+double MotionScore(const AVFrame *frame) {
+  const AVFrameSideData *side_data =
+      av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
+  if (!side_data) {
+    return frame->pict_type == AV_PICTURE_TYPE_I ? 0.0 : -1.0;
+  }
+  const AVMotionVector *mvs =
+      reinterpret_cast<const AVMotionVector *>(side_data->data);
+  size_t count = side_data->size / sizeof(AVMotionVector);
+  double sum = 0.0;
+  for (size_t i = 0; i < count; i++) {
+    const AVMotionVector &mv = mvs[i];
+    if (mv.motion_scale > 0) {
+      sum += mv.w * mv.h * hypot(mv.motion_x, mv.motion_y) / mv.motion_scale;
+    }
+  }
+  double area = static_cast<double>(frame->width) * frame->height;
+  return area > 0 ? sum / area : 0.0;
+}
+
+// Software decoder exporting motion vectors, as cheap as it gets: reference
+// frames only and no loop filter.
+static AVCodecContext *open_mv_decoder(const AVStream *stream) {
+  const AVCodec *decoder = avcodec_find_decoder(stream->codecpar->codec_id);
+  if (!decoder) {
+    std::cerr << "No software decoder found for codec "
+              << avcodec_get_name(stream->codecpar->codec_id) << "."
+              << std::endl;
+    return nullptr;
+  }
+  AVCodecContext *dec_ctx = avcodec_alloc_context3(decoder);
+  if (!dec_ctx) {
+    std::cerr << "Failed to allocate decoder context." << std::endl;
+    return nullptr;
+  }
+  int ret = avcodec_parameters_to_context(dec_ctx, stream->codecpar);
+  if (!check_error(ret, "Failed to copy codec parameters to decoder context")) {
+    dec_ctx->flags2 |= AV_CODEC_FLAG2_EXPORT_MVS;
+    dec_ctx->skip_frame = AVDISCARD_NONREF;
+    dec_ctx->skip_loop_filter = AVDISCARD_ALL;
+    dec_ctx->thread_count = 0;
+    ret = avcodec_open2(dec_ctx, decoder, nullptr);
+  }
+  if (check_error(ret, "Failed to open the motion vector decoder")) {
+    avcodec_free_context(&dec_ctx);
+  }
+  return dec_ctx;
+}
+
+// Collects (pts, motion score) of the frames the decoder has ready.
+static void receive_motion(AVCodecContext *dec_ctx, AVFrame *frame,
+                           std::vector<std::pair<int64_t, float>> &motion) {
+  while (avcodec_receive_frame(dec_ctx, frame) >= 0) {
+    motion.emplace_back(frame->best_effort_timestamp,
+                        static_cast<float>(MotionScore(frame)));
+    av_frame_unref(frame);
+  }
+}
+
+struct ScannedPacket {
+  int64_t ts;
+  int size;
+  bool key;
+};
+
+// Demuxes the video stream (decoding it for motion vectors if asked).
+static bool read_packets(const std::string &filename, bool motion_vectors,
+                         std::vector<ScannedPacket> &packets,
+                         std::vector<std::pair<int64_t, float>> &motion,
+                         AVRational &time_base) {
+  AVFormatContext *fmt_ctx = nullptr;
+  int ret = avformat_open_input(&fmt_ctx, filename.c_str(), nullptr, nullptr);
+  if (check_error(ret, "Failed to open input for the activity scan")) {
+    return false;
+  }
+  ret = avformat_find_stream_info(fmt_ctx, nullptr);
+  int stream_idx =
+      ret < 0 ? ret
+              : av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1,
+                                    nullptr, 0);
+  if (stream_idx < 0) {
+    std::cerr << "Could not find a video stream in " << filename << std::endl;
+    avformat_close_input(&fmt_ctx);
+    return false;
+  }
+  time_base = fmt_ctx->streams[stream_idx]->time_base;
+
+  AVCodecContext *dec_ctx = nullptr;
+  if (motion_vectors) {
+    dec_ctx = open_mv_decoder(fmt_ctx->streams[stream_idx]);
+  }
+  AVPacket *pkt = av_packet_alloc();
+  AVFrame *frame = av_frame_alloc();
+  ret = pkt && frame && (dec_ctx || !motion_vectors) ? 0 : AVERROR(ENOMEM);
+  while (ret >= 0 && (ret = av_read_frame(fmt_ctx, pkt)) >= 0) {
+    if (pkt->stream_index == stream_idx) {
+      int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+      packets.push_back({ts, pkt->size, (pkt->flags & AV_PKT_FLAG_KEY) != 0});
+      if (dec_ctx && avcodec_send_packet(dec_ctx, pkt) >= 0) {
+        receive_motion(dec_ctx, frame, motion);
+      }
+    }
+    av_packet_unref(pkt);
+  }
+  if (dec_ctx && avcodec_send_packet(dec_ctx, nullptr) >= 0) {
+    receive_motion(dec_ctx, frame, motion);
+  }
+  bool ok = ret == AVERROR_EOF ||
+            !check_error(ret, "Failed to read input for the activity scan");
+
+  av_frame_free(&frame);
+  av_packet_free(&pkt);
+  avcodec_free_context(&dec_ctx);
+  avformat_close_input(&fmt_ctx);
+  return ok;
+}
+
+// Turns the per frame active flags into padded, merged frame ranges.
+static void build_ranges(const ActivityProfile &profile,
+                         const ActivityScanOptions &options,
+                         std::vector<ActivityRange> &ranges) {
+  const std::vector<double> &times = profile.time_seconds;
+  int n = static_cast<int>(times.size());
+  double frame_seconds = n > 1 ? (times[n - 1] - times[0]) / (n - 1) : 0.0;
+  for (int i = 0; i < n; i++) {
+    if (!profile.active[i]) {
+      continue;
+    }
+    int start = i;
+    int end = i + 1;
+    while (end < n && profile.active[end]) {
+      end++;
+    }
+    i = end;
+    double start_time = times[start] - options.pad_seconds;
+    while (start > 0 && times[start - 1] >= start_time) {
+      start--;
+    }
+    double end_time = times[end - 1] + options.pad_seconds;
+    while (end < n && times[end] <= end_time) {
+      end++;
+    }
+
+    if (!ranges.empty() &&
+        (start <= ranges.back().end_frame ||
+         times[start] - ranges.back().end_seconds <=
+             options.merge_gap_seconds)) {
+      start = ranges.back().start_frame;
+      ranges.pop_back();
+    }
+    ActivityRange range;
+    range.start_frame = start;
+    range.end_frame = end;
+    range.start_seconds = times[start];
+    range.end_seconds = end < n ? times[end] : times[n - 1] + frame_seconds;
+    ranges.push_back(range);
+  }
+}
+
+bool ScanActivity(const std::string &filename,
+                  const ActivityScanOptions &options, ActivityProfile &profile,
+                  std::vector<ActivityRange> &ranges) {
+  profile = ActivityProfile();
+  ranges.clear();
+  std::vector<ScannedPacket> packets;
+  std::vector<std::pair<int64_t, float>> motion;
+  AVRational time_base;
+  if (!read_packets(filename, options.motion_vectors, packets, motion,
+                    time_base)) {
+    return false;
+  }
+  if (packets.empty()) {
+    std::cerr << "No video packets found in " << filename << std::endl;
+    return false;
+  }
+
+  // Display order, like the frames the reader returns.
+  std::stable_sort(packets.begin(), packets.end(),
+                   [](const ScannedPacket &a, const ScannedPacket &b) {
+                     return a.ts < b.ts;
+                   });
+  std::sort(motion.begin(), motion.end());
+  size_t n = packets.size();
+  std::vector<int> inter_sizes;
+  for (const ScannedPacket &packet : packets) {
+    profile.pts.push_back(packet.ts);
+    profile.time_seconds.push_back(packet.ts * av_q2d(time_base));
+    profile.packet_size.push_back(packet.size);
+    profile.keyframe.push_back(packet.key);
+    if (!packet.key) {
+      inter_sizes.push_back(packet.size);
+    }
+  }
+  if (inter_sizes.empty()) { // Intra only
+    inter_sizes = profile.packet_size;
+  }
+  std::nth_element(inter_sizes.begin(),
+                   inter_sizes.begin() + inter_sizes.size() / 2,
+                   inter_sizes.end());
+  profile.baseline_size = std::max(inter_sizes[inter_sizes.size() / 2], 1);
+
+  // Rolling sums over (t - window, t].
+  const std::vector<double> &times = profile.time_seconds;
+  double window = std::max(options.window_seconds, 1e-3);
+  int64_t bytes = 0;
+  int64_t inter_bytes = 0;
+  int inter_count = 0;
+  double inter_size = profile.baseline_size;
+  size_t first = 0;
+  auto motion_it = motion.begin();
+  for (size_t i = 0; i < n; i++) {
+    bytes += packets[i].size;
+    if (!packets[i].key) {
+      inter_bytes += packets[i].size;
+      inter_count++;
+    }
+    while (times[first] <= times[i] - window) {
+      bytes -= packets[first].size;
+      if (!packets[first].key) {
+        inter_bytes -= packets[first].size;
+        inter_count--;
+      }
+      first++;
+    }
+    if (inter_count > 0) { // Else keep the last value
+      inter_size = static_cast<double>(inter_bytes) / inter_count;
+    }
+    profile.bitrate.push_back(bytes * 8.0 / window);
+    profile.inter_size.push_back(inter_size);
+
+    float frame_motion = -1.0f;
+    while (motion_it != motion.end() && motion_it->first < packets[i].ts) {
+      ++motion_it;
+    }
+    if (motion_it != motion.end() && motion_it->first == packets[i].ts) {
+      frame_motion = motion_it->second;
+    }
+    profile.motion.push_back(frame_motion);
+    profile.active.push_back(
+        inter_size > options.threshold * profile.baseline_size ||
+        (options.motion_vectors && frame_motion > options.motion_threshold));
+  }
+
+  build_ranges(profile, options, ranges);
+#if !NDEBUG
+  int active = 0;
+  for (const ActivityRange &range : ranges) {
+    active += range.end_frame - range.start_frame;
+  }
+  std::cout << "Activity scan of " << filename << ": " << ranges.size()
+            << " ranges, " << active << " of " << n << " frames active."
+            << std::endl;
+#endif
+  return true;
+}
@@ -0,0 +1,61 @@
+#ifndef ACTIVITY_SCAN_H
+#define ACTIVITY_SCAN_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+// Options of ScanActivity(). A frame is active when the mean size of the
+// inter (non-key) packets over the last window_seconds exceeds threshold x
+// the median inter packet size of the file, i.e. of the static scene, or
+// (with motion_vectors) when its mean motion exceeds motion_threshold.
+struct ActivityScanOptions {
+  double window_seconds = 1.0;
+  double threshold = 2.0;
+  // Also decode (software, reference frames only, no loop filter) with
+  // exported motion vectors. Costs a decode, but catches small movers.
+  bool motion_vectors = false;
+  double motion_threshold = 0.5; // Mean motion in pixels per frame
+  double pad_seconds = 1.0;       // Added before and after each range
+  double merge_gap_seconds = 2.0; // Closer ranges are merged
+};
+
+// Active frames [start_frame, end_frame) in display order.
+struct ActivityRange {
+  int start_frame = 0;
+  int end_frame = 0;
+  double start_seconds = 0.0;
+  double end_seconds = 0.0;
+};
+
+// Per frame scan results in display order.
+struct ActivityProfile {
+  std::vector<int64_t> pts;
+  std::vector<double> time_seconds;
+  std::vector<int> packet_size;
+  std::vector<uint8_t> keyframe;
+  std::vector<double> bitrate;    // Bits per second over the window
+  std::vector<double> inter_size; // Mean inter packet size over the window
+  std::vector<float> motion;      // -1 where not decoded
+  std::vector<uint8_t> active;
+  double baseline_size = 0.0; // Median inter packet size
+};
+
+// Reads the packets of the video stream of filename (and decodes them for
+// motion vectors only) and returns the activity profile and the active
+// ranges, ready for FFMPEGVideoOptions::frame_ranges.
+bool ScanActivity(const std::string &filename,
+                  const ActivityScanOptions &options, ActivityProfile &profile,
+                  std::vector<ActivityRange> &ranges);
+
+// Mean motion vector length in pixels over the frame area, from the
+// AV_FRAME_DATA_MOTION_VECTORS side data (AV_CODEC_FLAG2_EXPORT_MVS); -1
+// without it. Intra frames without vectors score 0.
+double MotionScore(const AVFrame *frame);
+
+#endif // ACTIVITY_SCAN_H
@@ -0,0 +1,23 @@
+#ifndef AV_ERROR_H
+#define AV_ERROR_H
+
+#include <iostream>
+#include <string>
+
+extern "C" {
+#include <libavutil/error.h>
+}
+
+// Prints msg and the FFmpeg error text when ret is an error code. Returns
+// true on error.
+inline bool check_error(int ret, const std::string &msg) {
+  if (ret < 0) {
+    char errbuf[AV_ERROR_MAX_STRING_SIZE];
+    av_strerror(ret, errbuf, sizeof(errbuf));
+    std::cerr << msg << ": " << errbuf << std::endl;
+    return true; // Indicate error
+  }
+  return false; // Indicate success
+}
+
+#endif // AV_ERROR_H
@@ -8,10 +8,32 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include "activity_scan.h"
+#include "dlpack.h"
 #include "ffmpeg_video.h"
+#include "frame_broadcaster.h"
+#include "frame_client.h"
+#include "frame_ring.h"
+#include "ingest_manager.h"
+#include "live_video.h"
+#include "parallel_video.h"
+#include "session_governor.h"
 
 namespace py = pybind11;
 
+// One row of the per frame info array of get_next_batch(with_info=True).
+struct FrameInfoRecord {
+  int32_t frame_id;
+  int64_t pts;
+  char pict_type[2];
+  bool key_frame;
+  int32_t packet_size;
+  float qp_mean;
+  int32_t qp_min;
+  int32_t qp_max;
+  float motion;
+};
+
 // Function to convert cv::Mat to py::array_t (NumPy array) by copying data
 py::array_t<uint8_t> mat_to_numpy(const cv::Mat &mat) {
   if (!mat.isContinuous() || mat.depth() != CV_8U ||
@@ -42,15 +64,523 @@ py::array_t<uint8_t> mat_to_numpy(const cv::Mat &mat) {
   return result_array;
 }
 
+// Wraps a Mat into a py::array_t without copying. owner keeps the Mat's
+// data alive.
+py::array_t<uint8_t> mat_to_numpy_ref(const cv::Mat &mat,
+                                      const py::object &owner) {
+  std::vector<ssize_t> shape = {mat.rows, mat.cols};
+  std::vector<ssize_t> strides = {static_cast<ssize_t>(mat.step[0]),
+                                  static_cast<ssize_t>(mat.step[1])};
+  if (mat.channels() != 1) {
+    shape.push_back(mat.channels());
+    strides.push_back(static_cast<ssize_t>(mat.elemSize1()));
+  }
+  return py::array_t<uint8_t>(shape, strides, mat.data, owner);
+}
+
+// Function to expose a VideoFrame as a py::array_t (NumPy array) without
+// copying. The array keeps its own reference to the underlying AVFrame.
+// NV12/I420 frames become a tuple of plane arrays, (Y, UV) or (Y, U, V).
+py::object frame_to_numpy(const VideoFrame &frame) {
+  std::vector<cv::Mat> planes;
+  cv::Mat mat;
+  if (!frame.av) {
+    throw std::runtime_error("Unsupported frame format for numpy conversion.");
+  }
+  bool yuv = FFMPEGVideo::FrameToPlanes(frame.av.get(), planes);
+  if (!yuv && !FFMPEGVideo::FrameToMat(frame.av.get(), mat)) {
+    throw std::runtime_error("Unsupported frame format for numpy conversion.");
+  }
+
+  // The capsule owns a VideoFrame copy, i.e. one more AVFrame reference.
+  py::capsule owner(new VideoFrame(frame), [](void *p) {
+    delete reinterpret_cast<VideoFrame *>(p);
+  });
+  if (!yuv) {
+    return mat_to_numpy_ref(mat, owner);
+  }
+  py::tuple result(planes.size());
+  for (size_t i = 0; i < planes.size(); i++) {
+    result[i] = mat_to_numpy_ref(planes[i], owner);
+  }
+  return result;
+}
+
+// Copies packed frames (the historic get_next_frame behaviour), planar YUV
+// frames are handed out without a copy.
+py::object frame_to_python(const VideoFrame &frame) {
+  cv::Mat mat;
+  std::vector<cv::Mat> planes;
+  if (FFMPEGVideo::FrameToPlanes(frame.av.get(), planes)) {
+    return frame_to_numpy(frame);
+  } else if (!FFMPEGVideo::FrameToMat(frame.av.get(), mat)) {
+    return py::none();
+  }
+  return mat_to_numpy(mat);
+}
+
+// DLPack export of a frame. The managed tensor owns a VideoFrame copy, i.e.
+// one more AVFrame reference, dropped by the consumer through the deleter.
+struct DLPackFrame {
+  DLManagedTensor tensor;
+  VideoFrame frame;
+  int64_t shape[3];
+  int64_t strides[3];
+};
+
+py::capsule frame_to_dlpack(const VideoFrame &frame) {
+  std::vector<cv::Mat> planes;
+  cv::Mat mat;
+  if (!frame.av || FFMPEGVideo::FrameToPlanes(frame.av.get(), planes) ||
+      !FFMPEGVideo::FrameToMat(frame.av.get(), mat)) {
+    throw py::buffer_error("DLPack export needs a gray, bgr24 or rgb24 frame.");
+  }
+
+  DLPackFrame *ctx = new DLPackFrame();
+  ctx->frame = frame;
+  ctx->shape[0] = mat.rows;
+  ctx->shape[1] = mat.cols;
+  ctx->shape[2] = mat.channels();
+  ctx->strides[0] = static_cast<int64_t>(mat.step[0]);
+  ctx->strides[1] = mat.channels();
+  ctx->strides[2] = 1;
+  DLTensor &tensor = ctx->tensor.dl_tensor;
+  tensor.data = mat.data;
+  tensor.device = {kDLCPU, 0};
+  tensor.ndim = mat.channels() == 1 ? 2 : 3;
+  tensor.dtype = {kDLUInt, 8, 1};
+  tensor.shape = ctx->shape;
+  tensor.strides = ctx->strides;
+  tensor.byte_offset = 0;
+  ctx->tensor.manager_ctx = ctx;
+  ctx->tensor.deleter = [](DLManagedTensor *self) {
+    delete static_cast<DLPackFrame *>(self->manager_ctx);
+  };
+
+  // A consumer renames the capsule to "used_dltensor" and owns the tensor
+  // from then on, else the capsule frees it.
+  PyObject *capsule =
+      PyCapsule_New(&ctx->tensor, "dltensor", [](PyObject *capsule) {
+        if (PyCapsule_IsValid(capsule, "dltensor")) {
+          DLManagedTensor *tensor = static_cast<DLManagedTensor *>(
+              PyCapsule_GetPointer(capsule, "dltensor"));
+          tensor->deleter(tensor);
+        }
+      });
+  if (!capsule) {
+    ctx->tensor.deleter(&ctx->tensor);
+    throw py::error_already_set();
+  }
+  return py::reinterpret_steal<py::capsule>(capsule);
+}
+
+// Read-only views of a frame living in shared memory, kept mapped by owner.
+// YUV frames become a tuple of planes.
+py::object shared_frame_to_numpy(const AVFrame *frame,
+                                 const py::object &owner) {
+  std::vector<cv::Mat> planes;
+  cv::Mat mat;
+  if (!FFMPEGVideo::FrameToPlanes(frame, planes)) {
+    if (!FFMPEGVideo::FrameToMat(frame, mat)) {
+      return py::none();
+    }
+    planes.push_back(mat);
+  }
+  py::list views;
+  for (const cv::Mat &plane : planes) {
+    py::array_t<uint8_t> view = mat_to_numpy_ref(plane, owner);
+    view.attr("setflags")(py::arg("write") = false);
+    views.append(view);
+  }
+  if (views.size() == 1) {
+    return views[0];
+  }
+  return py::tuple(views);
+}
+
+// Options pickle as a dict of their properties, so new options need no
+// extra code here.
+py::dict options_to_dict(const FFMPEGVideoOptions &options) {
+  py::object py_options = py::cast(options);
+  py::object property = py::module_::import("builtins").attr("property");
+  py::dict state;
+  for (py::handle item :
+       py_options.get_type().attr("__dict__").attr("items")()) {
+    py::tuple member = item.cast<py::tuple>();
+    if (py::isinstance(member[1], property)) {
+      state[member[0]] = py_options.attr(member[0]);
+    }
+  }
+  return state;
+}
+
+FFMPEGVideoOptions options_from_dict(const py::dict &state) {
+  FFMPEGVideoOptions options;
+  py::object py_options =
+      py::cast(&options, py::return_value_policy::reference);
+  for (auto item : state) {
+    py::setattr(py_options, item.first, item.second);
+  }
+  return options;
+}
+
+// Copies a vector into a new 1-D array.
+template <typename T>
+py::array_t<T> vector_to_numpy(const std::vector<T> &values) {
+  return py::array_t<T>(static_cast<py::ssize_t>(values.size()),
+                        values.data());
+}
+
+py::dict frame_info_to_python(const CompressedFrameInfo &info) {
+  py::dict result;
+  result["pts"] = info.pts;
+  result["pict_type"] = std::string(1, info.pict_type);
+  result["key_frame"] = info.key_frame;
+  result["packet_size"] = info.packet_size;
+  result["qp_mean"] = info.qp_mean;
+  result["qp_min"] = info.qp_min;
+  result["qp_max"] = info.qp_max;
+  result["motion"] = info.motion;
+  result["motion_vectors"] = vector_to_numpy(info.motion_vectors);
+  return result;
+}
+
+py::object letterbox_to_python(const FFMPEGVideo &video) {
+  LetterboxTransform transform;
+  if (!video.get_letterbox(transform)) {
+    return py::none();
+  }
+  py::dict result;
+  result["scale"] = transform.scale;
+  result["pad_x"] = transform.pad_x;
+  result["pad_y"] = transform.pad_y;
+  result["width"] = transform.width;
+  result["height"] = transform.height;
+  return result;
+}
+
 PYBIND11_MODULE(ffmpeg_video, m) {
   m.doc() = "pybind11 plugin for FFMPEGVideo class";
 
+  PYBIND11_NUMPY_DTYPE(AVMotionVector, source, w, h, src_x, src_y, dst_x,
+                       dst_y, flags, motion_x, motion_y, motion_scale);
+  PYBIND11_NUMPY_DTYPE(FrameInfoRecord, frame_id, pts, pict_type, key_frame,
+                       packet_size, qp_mean, qp_min, qp_max, motion);
+
+  py::class_<FFMPEGVideoOptions>(m, "FFMPEGVideoOptions")
+      .def(py::init<>())
+      .def(py::pickle(&options_to_dict, &options_from_dict))
+      .def_readwrite("output_names", &FFMPEGVideoOptions::output_names,
+                     "Labels of the filter graph outputs to expose (empty "
+                     "for a single unlabeled output).")
+      .def_readwrite("nonblocking", &FFMPEGVideoOptions::nonblocking,
+                     "Open the input in non-blocking mode (network inputs).")
+      .def_readwrite("force_software", &FFMPEGVideoOptions::force_software,
+                     "Always use the software decoder.")
+      .def_readwrite("sw_fallback", &FFMPEGVideoOptions::sw_fallback,
+                     "Fall back to the software decoder when no hardware "
+                     "session is granted in time or the hardware open "
+                     "fails.")
+      .def_readwrite("session_priority", &FFMPEGVideoOptions::session_priority,
+                     "Queue priority for a decoder session (higher first, "
+                     "PRIORITY policy only).")
+      .def_readwrite("session_wait_ms", &FFMPEGVideoOptions::session_wait_ms,
+                     "Longest wait for a decoder session, -1 waits forever.")
+      .def_readwrite("sw_filter_descr", &FFMPEGVideoOptions::sw_filter_descr,
+                     "Filter description used with the software decoder "
+                     "(empty reuses the main one).")
+      .def_readwrite("degrade_latency_ms",
+                     &FFMPEGVideoOptions::degrade_latency_ms,
+                     "Average hardware decode time per frame above which the "
+                     "stream switches to software decoding at the next "
+                     "keyframe (0 disables). Needs a sw_filter_descr when "
+                     "the filter description uses hardware frames.")
+      .def_readwrite("recover_after_ms", &FFMPEGVideoOptions::recover_after_ms,
+                     "Time spent on software decoding before the hardware "
+                     "decoder is tried again.")
+      .def_readwrite("decoder_threads", &FFMPEGVideoOptions::decoder_threads,
+                     "Software decoder threads: -1 picks a count from the "
+                     "resolution, cores and open readers, 0 leaves it to "
+                     "libavcodec.")
+      .def_readwrite("decoder_thread_type",
+                     &FFMPEGVideoOptions::decoder_thread_type,
+                     "Software decoder threading: 'frame', 'slice', "
+                     "'frame+slice' or 'auto'.")
+      .def_readwrite("filter_threads", &FFMPEGVideoOptions::filter_threads,
+                     "Filter graph threads (0 picks the core count).")
+      .def_readwrite("filter_thread_type",
+                     &FFMPEGVideoOptions::filter_thread_type,
+                     "Filter graph threading: 'slice' or 'none'.")
+      .def_readwrite("sws_threads", &FFMPEGVideoOptions::sws_threads,
+                     "swscale slice threads of the scale/format filters and "
+                     "the swscale converter (1 disables, 0 picks "
+                     "automatically).")
+      .def_readwrite("converter", &FFMPEGVideoOptions::converter,
+                     "'avfilter', 'swscale' (cached SwsContext, no filter "
+                     "graph), 'simd' (built-in NV12/YUV420P to bgr24/rgb24 "
+                     "kernels), 'luma' (gray output from the Y plane, no "
+                     "copy at the source size) or 'auto' (luma for gray, "
+                     "else swscale, for plain scale/format descriptions).")
+      .def_readwrite("out_width", &FFMPEGVideoOptions::out_width,
+                     "Converter output width (0 keeps the source width).")
+      .def_readwrite("out_height", &FFMPEGVideoOptions::out_height,
+                     "Converter output height (0 keeps the source height).")
+      .def_readwrite("out_format", &FFMPEGVideoOptions::out_format,
+                     "Converter output pixel format, e.g. 'bgr24' "
+                     "(overrides the filter description).")
+      .def_readwrite("resize_filter", &FFMPEGVideoOptions::resize_filter,
+                     "Resize sampling of the simd and luma converters: "
+                     "'area' or 'bilinear'.")
+      .def_readwrite("letterbox_width", &FFMPEGVideoOptions::letterbox_width,
+                     "Letterbox canvas width (0 disables letterboxing).")
+      .def_readwrite("letterbox_height",
+                     &FFMPEGVideoOptions::letterbox_height,
+                     "Letterbox canvas height.")
+      .def_readwrite("letterbox_pad", &FFMPEGVideoOptions::letterbox_pad,
+                     "Byte value of the letterbox padding.")
+      .def_readwrite("tensor_layout", &FFMPEGVideoOptions::tensor_layout,
+                     "Tensor output layout: 'chw' or 'hwc'.")
+      .def_readwrite("tensor_channel_order",
+                     &FFMPEGVideoOptions::tensor_channel_order,
+                     "Tensor output channel order: 'rgb' or 'bgr'.")
+      .def_readwrite("tensor_dtype", &FFMPEGVideoOptions::tensor_dtype,
+                     "Tensor output dtype: 'float32', 'float16' or 'uint8'.")
+      .def_readwrite("tensor_mean", &FFMPEGVideoOptions::tensor_mean,
+                     "Subtracted per channel before scaling (one value or "
+                     "three, in tensor channel order).")
+      .def_readwrite("tensor_scale", &FFMPEGVideoOptions::tensor_scale,
+                     "Multiplied per channel after the mean subtraction, "
+                     "e.g. 1/255 or 1/std.")
+      .def_readwrite("keep_decoded", &FFMPEGVideoOptions::keep_decoded,
+                     "Keep the decoded frame behind the last output for "
+                     "get_decoded_frame() and get_crops().")
+      .def_readwrite("shm_ring_name", &FFMPEGVideoOptions::shm_ring_name,
+                     "Publish every frame into a shared memory ring of this "
+                     "name for FrameRingReader processes (empty disables).")
+      .def_readwrite("shm_ring_slots", &FFMPEGVideoOptions::shm_ring_slots,
+                     "Number of frame slots in the shared memory ring.")
+      .def_readwrite("shm_ring_slot_size",
+                     &FFMPEGVideoOptions::shm_ring_slot_size,
+                     "Bytes per ring slot, at least the first frame (0 sizes "
+                     "them by it). Larger frames are skipped.")
+      .def_readwrite("dedup_threshold", &FFMPEGVideoOptions::dedup_threshold,
+                     "Drop frames whose luma thumbnail differs from the last "
+                     "frame passed on by at most this mean absolute "
+                     "difference (0-255), before conversion. 0 disables.")
+      .def_readwrite("dedup_max_skip", &FFMPEGVideoOptions::dedup_max_skip,
+                     "Pass a frame after this many drops in a row (0 for no "
+                     "limit).")
+      .def_readwrite("dedup_thumb_width",
+                     &FFMPEGVideoOptions::dedup_thumb_width,
+                     "Width of the duplicate detection thumbnail.")
+      .def_readwrite("dedup_thumb_height",
+                     &FFMPEGVideoOptions::dedup_thumb_height,
+                     "Height of the duplicate detection thumbnail.")
+      .def_readwrite("compute_stats", &FFMPEGVideoOptions::compute_stats,
+                     "Compute luma statistics of every decoded frame, see "
+                     "get_last_frame_stats().")
+      .def_readwrite("stats_width", &FFMPEGVideoOptions::stats_width,
+                     "Luma width the stats are computed at (0 keeps the "
+                     "source width).")
+      .def_readwrite("stats_height", &FFMPEGVideoOptions::stats_height,
+                     "Luma height the stats are computed at (0 keeps the "
+                     "source height).")
+      .def_readwrite("stats_bins", &FFMPEGVideoOptions::stats_bins,
+                     "Histogram bins (1-256).")
+      .def_readwrite("min_mean_luma", &FFMPEGVideoOptions::min_mean_luma,
+                     "Drop frames darker than this mean luma.")
+      .def_readwrite("max_mean_luma", &FFMPEGVideoOptions::max_mean_luma,
+                     "Drop frames brighter than this mean luma.")
+      .def_readwrite("min_contrast", &FFMPEGVideoOptions::min_contrast,
+                     "Drop frames whose luma standard deviation is below "
+                     "this.")
+      .def_readwrite("min_laplacian_var",
+                     &FFMPEGVideoOptions::min_laplacian_var,
+                     "Drop frames whose Laplacian variance (sharpness) is "
+                     "below this, i.e. blurry ones.")
+      .def_readwrite("export_side_data",
+                     &FFMPEGVideoOptions::export_side_data,
+                     "Export picture type, keyframe flag and packet size of "
+                     "every frame, plus motion vectors and QP with the "
+                     "software decoder, see get_next_frame_with_info().")
+      .def_readwrite("frame_ranges", &FFMPEGVideoOptions::frame_ranges,
+                     "Decode only these sorted (start, end) frame ranges, "
+                     "e.g. from scan_activity(); the frames between them are "
+                     "skipped (seekable inputs only).")
+      .def_readwrite("sample_every_n", &FFMPEGVideoOptions::sample_every_n,
+                     "Hand out every n-th frame only (0 or 1 for all).")
+      .def_readwrite("sample_target_fps",
+                     &FFMPEGVideoOptions::sample_target_fps,
+                     "Hand out the first frame at or after each "
+                     "1 / sample_target_fps step of the timestamps.")
+      .def_readwrite("sample_timestamps",
+                     &FFMPEGVideoOptions::sample_timestamps,
+                     "Hand out the first frame at or after each of these "
+                     "sorted times (seconds). Unsampled frames are skipped "
+                     "by seeking or decoded without filtering and "
+                     "conversion.");
+
+  py::class_<ActivityScanOptions>(m, "ActivityScanOptions")
+      .def(py::init<>())
+      .def_readwrite("window_seconds", &ActivityScanOptions::window_seconds,
+                     "Window of the rolling packet size and bitrate.")
+      .def_readwrite("threshold", &ActivityScanOptions::threshold,
+                     "Active when the rolling mean inter packet size exceeds "
+                     "this multiple of the file's median inter packet size.")
+      .def_readwrite("motion_vectors", &ActivityScanOptions::motion_vectors,
+                     "Also decode (software, reference frames, no loop "
+                     "filter) with exported motion vectors.")
+      .def_readwrite("motion_threshold",
+                     &ActivityScanOptions::motion_threshold,
+                     "Active when the mean motion exceeds this many pixels.")
+      .def_readwrite("pad_seconds", &ActivityScanOptions::pad_seconds,
+                     "Added before and after each active range.")
+      .def_readwrite("merge_gap_seconds",
+                     &ActivityScanOptions::merge_gap_seconds,
+                     "Ranges closer than this are merged.");
+
+  m.def(
+      "scan_activity",
+      [](const std::string &filename,
+         const ActivityScanOptions &options) -> py::object {
+        ActivityProfile profile;
+        std::vector<ActivityRange> ranges;
+        bool ok;
+        {
+          py::gil_scoped_release release;
+          ok = ScanActivity(filename, options, profile, ranges);
+        }
+        if (!ok) {
+          return py::none();
+        }
+        py::list frame_ranges;
+        py::list time_ranges;
+        for (const ActivityRange &range : ranges) {
+          frame_ranges.append(
+              py::make_tuple(range.start_frame, range.end_frame));
+          time_ranges.append(
+              py::make_tuple(range.start_seconds, range.end_seconds));
+        }
+        py::dict result;
+        result["frame_ranges"] = frame_ranges;
+        result["time_ranges"] = time_ranges;
+        result["baseline_size"] = profile.baseline_size;
+        result["pts"] = vector_to_numpy(profile.pts);
+        result["time_seconds"] = vector_to_numpy(profile.time_seconds);
+        result["packet_size"] = vector_to_numpy(profile.packet_size);
+        result["keyframe"] =
+            vector_to_numpy(profile.keyframe).attr("astype")("bool");
+        result["bitrate"] = vector_to_numpy(profile.bitrate);
+        result["inter_size"] = vector_to_numpy(profile.inter_size);
+        result["motion"] = vector_to_numpy(profile.motion);
+        result["active"] =
+            vector_to_numpy(profile.active).attr("astype")("bool");
+        return result;
+      },
+      py::arg("filename"), py::arg("options") = ActivityScanOptions(),
+      "Reads the packets of a file (no decoding unless motion_vectors) and "
+      "returns a dict with the active frame_ranges (for "
+      "FFMPEGVideoOptions.frame_ranges) and time_ranges, and a per frame "
+      "profile in display order: pts, time_seconds, packet_size, keyframe, "
+      "bitrate, inter_size, motion (-1 if not decoded) and active. Returns "
+      "None on errors.");
+
+  py::enum_<SessionQueuePolicy>(m, "SessionQueuePolicy")
+      .value("FIFO", SessionQueuePolicy::Fifo)
+      .value("PRIORITY", SessionQueuePolicy::Priority);
+
+  m.def(
+      "configure_sessions",
+      [](int max_sessions, SessionQueuePolicy policy, bool govern_software) {
+        HwSessionGovernor::instance().configure(max_sessions, policy,
+                                                govern_software);
+      },
+      py::arg("max_sessions"), py::arg("policy") = SessionQueuePolicy::Fifo,
+      py::arg("govern_software") = false,
+      "Caps concurrent hardware decoder sessions process-wide (0 disables "
+      "the cap). With govern_software=True software decoders are counted "
+      "too, e.g. to test the queueing without hardware.");
+  m.def(
+      "get_session_stats",
+      []() {
+        SessionGovernorStats stats = HwSessionGovernor::instance().get_stats();
+        py::dict result;
+        result["max_sessions"] = stats.max_sessions;
+        result["active"] = stats.active;
+        result["peak_active"] = stats.peak_active;
+        result["waiting"] = stats.waiting;
+        result["granted"] = stats.granted;
+        result["timeouts"] = stats.timeouts;
+        result["fallbacks"] = stats.fallbacks;
+        result["hw_open_failures"] = stats.hw_open_failures;
+        result["wait_total_ms"] = stats.wait_total_ms;
+        result["wait_max_ms"] = stats.wait_max_ms;
+        return result;
+      },
+      "Returns the decoder session governor counters.");
+  m.def(
+      "reset_session_stats",
+      []() { HwSessionGovernor::instance().reset_stats(); },
+      "Resets the session governor counters (not the active sessions).");
+  m.def("get_simd_kernel", &YuvConverter::get_kernel_name,
+        "Returns the row kernel of the simd converter on this CPU: 'neon', "
+        "'avx2' or 'scalar'.");
+
+  py::class_<VideoFrame>(m, "FrameRef",
+                         "Reference to a decoded frame, see get_crops().")
+      .def_readonly("frame_id", &VideoFrame::frame_id)
+      .def_readonly("pts", &VideoFrame::pts)
+      .def_readonly("time_seconds", &VideoFrame::time_seconds)
+      .def_property_readonly(
+          "width", [](const VideoFrame &frame) { return frame.av->width; })
+      .def_property_readonly(
+          "height", [](const VideoFrame &frame) { return frame.av->height; })
+      .def_property_readonly("format",
+                             [](const VideoFrame &frame) -> py::object {
+                               const char *name = av_get_pix_fmt_name(
+                                   static_cast<AVPixelFormat>(
+                                       frame.av->format));
+                               if (!name) {
+                                 return py::none();
+                               }
+                               return py::str(name);
+                             })
+      .def(
+          "__dlpack__",
+          [](const VideoFrame &frame, py::object stream) {
+            if (!stream.is_none()) {
+              throw py::buffer_error("Frames live on the CPU, stream must "
+                                     "be None.");
+            }
+            return frame_to_dlpack(frame);
+          },
+          py::arg("stream") = py::none(),
+          "Exports a gray (H, W) or bgr24/rgb24 (H, W, 3) uint8 frame "
+          "without a copy, e.g. torch.from_dlpack(frame_ref). The tensor "
+          "keeps the frame alive.")
+      .def(
+          "__dlpack_device__",
+          [](const VideoFrame &) {
+            return py::make_tuple(static_cast<int>(kDLCPU), 0);
+          })
+      .def(
+          "numpy", &frame_to_numpy,
+          "Returns the frame as a NumPy array (or plane tuple) without a "
+          "copy.");
+
   py::class_<FFMPEGVideo>(m, "FFMPEGVideo")
       .def(py::init<const std::string &, const std::string &>(),
            py::arg("filename"),
            py::arg("filter_descr_str") = "", // Default empty string
            "Initializes the FFMPEGVideo processor with a video file and an "
            "optional filter graph description.")
+      .def(py::init<const std::string &, const std::string &,
+                    const FFMPEGVideoOptions &>(),
+           py::arg("filename"), py::arg("filter_descr_str"),
+           py::arg("options"), py::call_guard<py::gil_scoped_release>(),
+           "Initializes the FFMPEGVideo processor with a video file, a filter "
+           "graph description and reader options. May wait for a decoder "
+           "session, see configure_sessions().")
       .def("is_initialized", &FFMPEGVideo::isInitialized,
            "Checks if the video processor was successfully initialized.")
       .def("get_video_width", &FFMPEGVideo::get_video_width,
@@ -73,17 +603,826 @@ PYBIND11_MODULE(ffmpeg_video, m) {
       .def("get_last_frame_time_seconds",
            &FFMPEGVideo::get_last_frame_time_seconds,
            "Returns the time in seconds of the last retrieved frame's PTS.")
+      .def("get_output_names", &FFMPEGVideo::get_output_names,
+           "Returns the names of the filter graph outputs.")
+      .def(py::pickle(
+          [](const FFMPEGVideo &self) {
+            return py::make_tuple(
+                self.get_filename(), self.get_filter_descr(),
+                options_to_dict(self.get_options()), self.get_frame_id(),
+                self.get_end_frame());
+          },
+          [](const py::tuple &state) {
+            if (state.size() != 5) {
+              throw std::runtime_error("Invalid FFMPEGVideo state.");
+            }
+            std::string filename = state[0].cast<std::string>();
+            std::string filter_descr = state[1].cast<std::string>();
+            FFMPEGVideoOptions options =
+                options_from_dict(state[2].cast<py::dict>());
+            // One ring has one writer, the clone must not replace it.
+            options.shm_ring_name.clear();
+            int frame_id = state[3].cast<int>();
+            int end_frame = state[4].cast<int>();
+            py::gil_scoped_release release;
+            std::unique_ptr<FFMPEGVideo> video(
+                new FFMPEGVideo(filename, filter_descr, options));
+            if (video->isInitialized() && (frame_id > 0 || end_frame >= 0) &&
+                !video->SetFrameRange(frame_id, end_frame)) {
+              std::cerr << "Failed to restore the position of " << filename
+                        << std::endl;
+            }
+            return video;
+          }))
+      .def(
+          "get_keyframes",
+          [](FFMPEGVideo &self) -> py::object {
+            std::vector<KeyframeEntry> keyframes;
+            bool ok;
+            {
+              py::gil_scoped_release release;
+              ok = self.GetKeyframeIndex(keyframes);
+            }
+            if (!ok) {
+              return py::none();
+            }
+            double time_base = av_q2d(self.get_time_base());
+            py::list result;
+            for (const KeyframeEntry &keyframe : keyframes) {
+              result.append(py::make_tuple(keyframe.frame_index, keyframe.pts,
+                                           keyframe.pts * time_base));
+            }
+            return result;
+          },
+          "Scans the file (demux only, once) and returns its keyframes as "
+          "(frame_index, pts, time_seconds) tuples, or None if the input is "
+          "not seekable.")
+      .def("seek", &FFMPEGVideo::SeekToFrame, py::arg("frame_index"),
+           py::call_guard<py::gil_scoped_release>(),
+           "Seeks so that the next frame read is frame_index, decoding from "
+           "the keyframe before it.")
+      .def("set_frame_range", &FFMPEGVideo::SetFrameRange, py::arg("start"),
+           py::arg("end") = -1, py::call_guard<py::gil_scoped_release>(),
+           "Restricts reading to frames [start, end), end -1 for no limit.")
+      .def(
+          "get_shard_bounds",
+          [](FFMPEGVideo &self, int n) -> py::object {
+            std::vector<int> bounds;
+            bool ok;
+            {
+              py::gil_scoped_release release;
+              ok = self.GetShardBounds(n, bounds);
+            }
+            if (!ok) {
+              return py::none();
+            }
+            py::list shards;
+            for (int k = 0; k < n; k++) {
+              shards.append(py::make_tuple(bounds[k], bounds[k + 1]));
+            }
+            return shards;
+          },
+          py::arg("n"),
+          "Splits the video into n keyframe-aligned [start, end) frame "
+          "ranges of about equal length.")
+      .def(
+          "shard",
+          [](FFMPEGVideo &self, int k, int n) {
+            if (n < 1 || k < 0 || k >= n) {
+              throw py::value_error("shard needs 0 <= k < n.");
+            }
+            std::vector<int> bounds;
+            bool ok;
+            {
+              py::gil_scoped_release release;
+              ok = self.GetShardBounds(n, bounds) &&
+                   self.SetFrameRange(bounds[k], bounds[k + 1]);
+            }
+            if (!ok) {
+              throw std::runtime_error("Failed to shard the video.");
+            }
+            return py::make_tuple(bounds[k], bounds[k + 1]);
+          },
+          py::arg("k"), py::arg("n"),
+          "Restricts the reader to shard k of n keyframe-aligned ranges, "
+          "e.g. shard(worker_id, num_workers), and returns its (start, end) "
+          "frame range. Survives pickling.")
+      .def("is_hardware_decoding", &FFMPEGVideo::isHardwareDecoding,
+           "Checks if frames are decoded by the hardware decoder.")
+      .def("get_converter_name", &FFMPEGVideo::get_converter_name,
+           "Returns 'swscale', 'simd' or 'luma' when the filter graph is "
+           "bypassed, else 'avfilter'.")
+      .def("get_decoder_name", &FFMPEGVideo::get_decoder_name)
+      .def("get_dedup_score", &FFMPEGVideo::get_dedup_score,
+           "Returns the thumbnail difference of the last decoded frame to "
+           "the last frame passed on (-1 if none or disabled).")
+      .def("get_dedup_passed", &FFMPEGVideo::get_dedup_passed,
+           "Returns the number of frames passed by duplicate suppression.")
+      .def("get_dedup_dropped", &FFMPEGVideo::get_dedup_dropped,
+           "Returns the number of frames dropped as duplicates.")
+      .def(
+          "get_last_frame_stats",
+          [](const FFMPEGVideo &self) -> py::object {
+            FrameStats stats;
+            if (!self.GetLastFrameStats(stats)) {
+              return py::none();
+            }
+            py::dict result;
+            result["mean"] = stats.mean;
+            result["stddev"] = stats.stddev;
+            result["laplacian_var"] = stats.laplacian_var;
+            result["histogram"] = vector_to_numpy(stats.histogram);
+            return result;
+          },
+          "Returns the luma statistics of the last decoded frame (the "
+          "current one right after get_next_frame(), or the last one "
+          "dropped): a dict with mean, stddev, laplacian_var and a uint32 "
+          "histogram. None without compute_stats.")
+      .def("get_stats_dropped", &FFMPEGVideo::get_stats_dropped,
+           "Returns the number of frames dropped by the stats thresholds.")
+      .def("get_session_wait_ms", &FFMPEGVideo::get_session_wait_ms,
+           "Returns how long the open waited for a decoder session.")
+      .def("get_decode_latency_ms", &FFMPEGVideo::get_decode_latency_ms,
+           "Returns the average time spent in the decoder per frame.")
+      .def("get_filter_threads", &FFMPEGVideo::get_filter_threads,
+           "Returns the filter graph thread count (0 is automatic).")
+      .def("get_filter_time_ms", &FFMPEGVideo::get_filter_time_ms,
+           "Returns the average filter stage time per frame that went "
+           "through the filter graph or converter.")
+      .def("get_decoder_threads", &FFMPEGVideo::get_decoder_threads,
+           "Returns the decoder thread count.")
+      .def("get_decoder_thread_type", &FFMPEGVideo::get_decoder_thread_type,
+           "Returns the threading type the software decoder actually uses.")
+      .def("get_hw_to_sw_switches", &FFMPEGVideo::get_hw_to_sw_switches,
+           "Returns how often the stream degraded to software decoding.")
+      .def("get_sw_to_hw_switches", &FFMPEGVideo::get_sw_to_hw_switches,
+           "Returns how often the stream went back to hardware decoding.")
+      .def(
+          "get_next_frames",
+          [](FFMPEGVideo &self) -> py::object {
+            std::vector<VideoFrame> video_frames;
+            if (!self.GetNextFrames(video_frames)) {
+              return py::none();
+            }
+            py::dict frames;
+            const std::vector<std::string> &names = self.get_output_names();
+            for (size_t i = 0; i < video_frames.size(); i++) {
+              frames[py::str(names[i])] = frame_to_python(video_frames[i]);
+            }
+            return frames;
+          },
+          "Retrieves all filter outputs of the next decoded video frame as a "
+          "dict of NumPy arrays keyed by output name. Returns None if the end "
+          "of the stream is reached or an error occurs.")
       .def(
           "get_next_frame",
           [](FFMPEGVideo &self) -> py::object {
-            cv::Mat frame_mat;
-            if (self.GetNextFrame(frame_mat)) {
-              return mat_to_numpy(frame_mat);
+            VideoFrame frame;
+            if (self.GetNextFrame(frame)) {
+              return frame_to_python(frame);
             }
             return py::none(); // Return None if no frame is available (EOF or
                                // error)
           },
           "Retrieves the next video frame as a NumPy array (uint8, BGR or "
-          "Grayscale). Returns None if the end of the stream is reached or "
-          "an error occurs.");
+          "Grayscale), or a tuple of plane arrays for nv12 (Y, UV) and "
+          "yuv420p (Y, U, V) outputs. Returns None if the end of the stream "
+          "is reached or an error occurs.")
+      .def(
+          "get_next_frame_ref",
+          [](FFMPEGVideo &self) -> py::object {
+            VideoFrame frame;
+            bool ok;
+            {
+              py::gil_scoped_release release;
+              ok = self.GetNextFrame(frame);
+            }
+            if (!ok) {
+              return py::none();
+            }
+            return py::cast(frame);
+          },
+          "Retrieves the next video frame as a FrameRef, which supports "
+          "DLPack (torch.from_dlpack) and numpy() without a copy. Returns "
+          "None if the end of the stream is reached or an error occurs.")
+      .def(
+          "get_next_letterboxed",
+          [](FFMPEGVideo &self) -> py::object {
+            VideoFrame frame;
+            if (!self.GetNextFrame(frame)) {
+              return py::none();
+            }
+            return py::make_tuple(frame_to_python(frame),
+                                  letterbox_to_python(self));
+          },
+          "Retrieves the next frame together with its letterbox transform, "
+          "a dict with scale, pad_x, pad_y and the scaled width/height. "
+          "Source coordinates are (x - pad_x) / scale. Returns None at the "
+          "end of the stream or on error.")
+      .def("get_letterbox", &letterbox_to_python,
+           "Returns the letterbox transform of the last frame, or None.")
+      .def(
+          "get_next_tensor",
+          [](FFMPEGVideo &self) -> py::object {
+            const TensorWriter &writer = self.get_tensor_writer();
+            VideoFrame frame;
+            std::vector<int64_t> shape;
+            bool ok;
+            {
+              py::gil_scoped_release release;
+              ok = self.GetNextFrame(frame) &&
+                   writer.get_shape(frame.av.get(), shape);
+            }
+            if (!ok) {
+              return py::none();
+            }
+            py::array tensor(py::dtype(writer.get_dtype()), shape);
+            void *dst = tensor.mutable_data();
+            {
+              py::gil_scoped_release release;
+              ok = writer.Write(frame.av.get(), dst);
+            }
+            return ok ? py::object(tensor) : py::none();
+          },
+          "Retrieves the first output of the next frame as a tensor shaped "
+          "by the tensor_* options, e.g. float32 (3, H, W) RGB. Returns None "
+          "at the end of the stream or on error.")
+      .def(
+          "get_next_batch",
+          [](FFMPEGVideo &self, int batch_size, bool with_info) -> py::object {
+            if (batch_size < 1) {
+              throw py::value_error("batch_size must be positive.");
+            }
+            const TensorWriter &writer = self.get_tensor_writer();
+            VideoFrame frame;
+            std::vector<int64_t> shape;
+            bool ok;
+            {
+              py::gil_scoped_release release;
+              ok = self.GetNextFrame(frame) &&
+                   writer.get_shape(frame.av.get(), shape);
+            }
+            if (!ok) {
+              return py::none();
+            }
+
+            std::vector<int64_t> batch_shape = shape;
+            batch_shape.insert(batch_shape.begin(), batch_size);
+            py::array batch(py::dtype(writer.get_dtype()), batch_shape);
+            uint8_t *dst = static_cast<uint8_t *>(batch.mutable_data());
+            size_t tensor_bytes = batch.nbytes() / batch_size;
+            int count = 0;
+            std::vector<FrameInfoRecord> records;
+            std::vector<AVMotionVector> mvs;
+            std::vector<int64_t> mv_offsets(1, 0);
+            {
+              py::gil_scoped_release release;
+              std::vector<VideoFrame> next;
+              std::vector<int64_t> frame_shape;
+              CompressedFrameInfo info;
+              while (writer.Write(frame.av.get(), dst + count * tensor_bytes)) {
+                if (with_info) {
+                  if (!self.GetLastFrameInfo(info)) {
+                    // Placeholder row, so rows keep matching batch indices
+                    info = CompressedFrameInfo();
+                    info.pts = frame.pts;
+                  }
+                  FrameInfoRecord record = {frame.frame_id, info.pts,
+                                            {info.pict_type, 0},
+                                            info.key_frame, info.packet_size,
+                                            info.qp_mean, info.qp_min,
+                                            info.qp_max, info.motion};
+                  records.push_back(record);
+                  mvs.insert(mvs.end(), info.motion_vectors.begin(),
+                             info.motion_vectors.end());
+                  mv_offsets.push_back(static_cast<int64_t>(mvs.size()));
+                }
+                if (++count == batch_size || !self.GetNextFrames(next)) {
+                  break;
+                }
+                if (!writer.get_shape(next[0].av.get(), frame_shape) ||
+                    frame_shape != shape) {
+                  // Starts the next batch
+                  self.UngetFrames(next);
+                  break;
+                }
+                frame = next[0];
+              }
+            }
+            if (count == 0) {
+              return py::none();
+            }
+            py::object result = batch;
+            if (count < batch_size) {
+              result = batch.attr("__getitem__")(py::slice(0, count, 1));
+            }
+            if (!with_info) {
+              return result;
+            }
+            py::dict info;
+            info["frames"] = vector_to_numpy(records);
+            info["motion_vectors"] = vector_to_numpy(mvs);
+            info["motion_vector_offsets"] = vector_to_numpy(mv_offsets);
+            return py::make_tuple(result, info);
+          },
+          py::arg("batch_size"), py::arg("with_info") = false,
+          "Writes the tensors of up to batch_size frames straight into one "
+          "(N, ...) array. The batch is shorter at the end of the stream or "
+          "when the frame size changes (that frame starts the next batch). "
+          "Returns None if no frame is left. With with_info=True (and the "
+          "export_side_data option) returns (batch, info): info['frames'] "
+          "is a structured array (frame_id, pts, pict_type, key_frame, "
+          "packet_size, qp_mean, qp_min, qp_max, motion) with one row per "
+          "batch frame (pict_type '?' and -1 values where the info is "
+          "missing) and the motion "
+          "vectors of frame i are info['motion_vectors'][offsets[i]:"
+          "offsets[i + 1]], offsets being info['motion_vector_offsets'].")
+      .def(
+          "get_next_frame_with_info",
+          [](FFMPEGVideo &self) -> py::object {
+            VideoFrame frame;
+            CompressedFrameInfo info;
+            bool ok;
+            bool has_info;
+            {
+              py::gil_scoped_release release;
+              ok = self.GetNextFrame(frame);
+              has_info = ok && self.GetLastFrameInfo(info);
+            }
+            if (!ok) {
+              return py::none();
+            }
+            return py::make_tuple(
+                frame_to_python(frame),
+                has_info ? py::object(frame_info_to_python(info))
+                         : py::object(py::none()));
+          },
+          "Retrieves the next frame like get_next_frame() together with the "
+          "compressed-domain info of its decoded frame (export_side_data "
+          "option, else None): a dict with pts, pict_type, key_frame, "
+          "packet_size, qp_mean/qp_min/qp_max (-1 if unknown), motion (mean "
+          "motion in pixels, -1 if unknown) and motion_vectors, a structured "
+          "array with the AVMotionVector fields.")
+      .def(
+          "decode_next_frame",
+          [](FFMPEGVideo &self) -> py::object {
+            std::shared_ptr<AVFrame> decoded;
+            CompressedFrameInfo info;
+            bool ok;
+            bool has_info;
+            {
+              py::gil_scoped_release release;
+              ok = self.DecodeFrame(decoded);
+              has_info = ok && self.GetFrameInfo(decoded.get(), info);
+            }
+            if (!ok) {
+              return py::none();
+            }
+            VideoFrame frame;
+            frame.av = decoded;
+            frame.frame_id = self.get_frame_id();
+            frame.pts = decoded->pts;
+            if (decoded->pts != AV_NOPTS_VALUE) {
+              frame.time_seconds =
+                  decoded->pts * av_q2d(self.get_time_base());
+            }
+            return py::make_tuple(
+                py::cast(frame),
+                has_info ? py::object(frame_info_to_python(info))
+                         : py::object(py::none()));
+          },
+          "Decodes the next frame without filtering or converting it and "
+          "returns (FrameRef, info), info as in get_next_frame_with_info(). "
+          "Pass the frames worth converting to filter_frame(). Do not mix "
+          "with get_next_frame*() on the same reader.")
+      .def(
+          "filter_frame",
+          [](FFMPEGVideo &self, const VideoFrame &decoded) -> py::object {
+            std::vector<VideoFrame> frames;
+            int ret;
+            {
+              py::gil_scoped_release release;
+              ret = self.FilterFrame(decoded.av.get(), frames);
+            }
+            if (ret == AVERROR(EAGAIN)) {
+              return py::none();
+            } else if (ret < 0 || frames.empty()) {
+              throw std::runtime_error("Failed to filter the frame.");
+            }
+            return frame_to_python(frames[0]);
+          },
+          py::arg("frame_ref"),
+          "Filters/converts a frame from decode_next_frame() and returns the "
+          "first output like get_next_frame(), or None when there is no "
+          "output yet (the filter graph holds the frame, or a gate dropped "
+          "it). Raises RuntimeError on errors. Safe to call from several "
+          "threads.")
+      .def(
+          "get_decoded_frame",
+          [](const FFMPEGVideo &self) -> py::object {
+            VideoFrame frame;
+            if (!self.GetDecodedFrame(frame)) {
+              return py::none();
+            }
+            return py::cast(frame);
+          },
+          "Returns a FrameRef to the decoded frame behind the last output "
+          "(needs keep_decoded), or None.")
+      .def(
+          "get_crops",
+          [](FFMPEGVideo &self, py::object frame_ref,
+             py::array_t<int, py::array::c_style | py::array::forcecast> boxes,
+             py::object size, const std::string &format) -> py::object {
+            VideoFrame frame;
+            if (frame_ref.is_none()) {
+              if (!self.GetDecodedFrame(frame)) {
+                throw py::value_error(
+                    "No decoded frame, set the keep_decoded option.");
+              }
+            } else {
+              frame = frame_ref.cast<VideoFrame>();
+            }
+            if (boxes.ndim() != 2 || boxes.shape(1) != 4) {
+              throw py::value_error("boxes must be shaped (K, 4), x1 y1 x2 "
+                                    "y2.");
+            }
+            int width, height;
+            if (py::isinstance<py::int_>(size)) {
+              width = height = size.cast<int>();
+            } else {
+              std::pair<int, int> wh = size.cast<std::pair<int, int>>();
+              width = wh.first;
+              height = wh.second;
+            }
+            AVPixelFormat pix_fmt = av_get_pix_fmt(format.c_str());
+            std::vector<CropBox> crop_boxes(boxes.shape(0));
+            for (size_t i = 0; i < crop_boxes.size(); i++) {
+              crop_boxes[i].x1 = boxes.at(i, 0);
+              crop_boxes[i].y1 = boxes.at(i, 1);
+              crop_boxes[i].x2 = boxes.at(i, 2);
+              crop_boxes[i].y2 = boxes.at(i, 3);
+            }
+            py::array_t<uint8_t> crops(std::vector<py::ssize_t>{
+                static_cast<py::ssize_t>(crop_boxes.size()), height, width,
+                3});
+            uint8_t *dst = crops.mutable_data();
+            bool ok;
+            {
+              py::gil_scoped_release release;
+              ok = self.GetCrops(frame.av.get(), crop_boxes, width, height,
+                                 pix_fmt, dst);
+            }
+            if (!ok) {
+              throw std::runtime_error("Failed to crop the frame.");
+            }
+            return crops;
+          },
+          py::arg("frame_ref") = py::none(), py::arg("boxes"),
+          py::arg("size"), py::arg("format") = "bgr24",
+          "Crops the (K, 4) x1 y1 x2 y2 boxes out of a decoded NV12/YUV420P "
+          "frame (default: get_decoded_frame()) and resizes each to size, "
+          "(w, h) or an int, in a single pass. Returns a (K, h, w, 3) uint8 "
+          "array. Boxes are clipped to the frame and their origin rounded "
+          "down to even.");
+
+  py::enum_<DropPolicy>(m, "DropPolicy")
+      .value("BLOCK", DropPolicy::Block)
+      .value("DROP_OLDEST", DropPolicy::DropOldest)
+      .value("LATEST_ONLY", DropPolicy::LatestOnly);
+
+  py::class_<FrameSubscription, std::shared_ptr<FrameSubscription>>(
+      m, "FrameSubscription")
+      .def(
+          "get",
+          [](FrameSubscription &self, int timeout_ms) -> py::object {
+            VideoFrame frame;
+            bool ok;
+            {
+              py::gil_scoped_release release;
+              ok = self.Pop(frame, timeout_ms);
+            }
+            if (!ok) {
+              return py::none();
+            }
+            return frame_to_numpy(frame);
+          },
+          py::arg("timeout_ms") = -1,
+          "Waits for the next frame and returns it as a NumPy array sharing "
+          "the decoded buffer. Returns None on timeout or end of stream.")
+      .def("close", &FrameSubscription::Close,
+           "Unsubscribes and releases the queued frames.")
+      .def("is_closed", &FrameSubscription::isClosed)
+      .def("get_capacity", &FrameSubscription::get_capacity)
+      .def("get_policy", &FrameSubscription::get_policy)
+      .def("get_queued", &FrameSubscription::get_queued,
+           "Returns the number of frames waiting in the queue.")
+      .def("get_delivered", &FrameSubscription::get_delivered,
+           "Returns the number of frames handed out by get().")
+      .def("get_dropped", &FrameSubscription::get_dropped,
+           "Returns the number of frames dropped by the drop policy.");
+
+  py::class_<FrameRingReader>(m, "FrameRingReader")
+      .def(py::init([](const std::string &name) {
+             std::unique_ptr<FrameRingReader> reader(new FrameRingReader());
+             reader->Open(name);
+             return reader;
+           }),
+           py::arg("name"),
+           "Maps the shared memory frame ring published by a reader with "
+           "the shm_ring_name option, possibly in another process.")
+      .def("is_open", &FrameRingReader::isOpen)
+      .def(
+          "read",
+          [](py::object self, int timeout_ms) -> py::object {
+            FrameRingReader &reader = self.cast<FrameRingReader &>();
+            std::unique_ptr<AVFrame, void (*)(AVFrame *)> frame(
+                av_frame_alloc(), [](AVFrame *f) { av_frame_free(&f); });
+            FrameRingInfo info;
+            bool ok;
+            {
+              py::gil_scoped_release release;
+              ok = frame && reader.Read(frame.get(), info, timeout_ms);
+            }
+            if (!ok) {
+              return py::none();
+            }
+
+            // The views keep the reader, i.e. the mapping, alive.
+            py::object image = shared_frame_to_numpy(frame.get(), self);
+            if (image.is_none()) {
+              return py::none();
+            }
+            py::dict meta;
+            meta["seq"] = info.seq;
+            meta["frame_id"] = info.frame_id;
+            meta["pts"] = info.pts;
+            meta["time_seconds"] = info.time_seconds;
+            return py::make_tuple(image, meta);
+          },
+          py::arg("timeout_ms") = -1,
+          "Waits for the next frame and returns (frame, info) where frame is "
+          "a read-only NumPy view into the ring (a plane tuple for YUV) and "
+          "info holds seq, frame_id, pts and time_seconds. The view is "
+          "overwritten once the writer laps the ring, see is_current(). "
+          "Returns None on timeout or once the writer closed the ring.")
+      .def("is_current", &FrameRingReader::IsCurrent, py::arg("seq"),
+           "Checks that the frame seq was not overwritten yet, e.g. after "
+           "processing its view.")
+      .def("is_writer_closed", &FrameRingReader::isWriterClosed)
+      .def("get_slots", &FrameRingReader::get_slots)
+      .def("get_head", &FrameRingReader::get_head,
+           "Returns the number of frames written to the ring.")
+      .def("get_dropped", &FrameRingReader::get_dropped,
+           "Returns the number of frames skipped because the reader lagged.");
+
+  py::class_<FrameClient>(m, "FrameClient")
+      .def(py::init([](const std::string &socket_path,
+                       const std::string &stream, int max_inflight) {
+             std::unique_ptr<FrameClient> client(new FrameClient());
+             client->Connect(socket_path, stream, max_inflight);
+             return client;
+           }),
+           py::arg("socket_path"), py::arg("stream"),
+           py::arg("max_inflight") = 4,
+           py::call_guard<py::gil_scoped_release>(),
+           "Subscribes to a stream of the frame server (cpp/frame-server). "
+           "The server drops frames while max_inflight of them are held.")
+      .def("is_connected", &FrameClient::isConnected)
+      .def("is_ended", &FrameClient::isEnded,
+           "Checks if the server ended the stream (or went away).")
+      .def(
+          "read",
+          [](FrameClient &self, int timeout_ms) -> py::object {
+            std::shared_ptr<ServerFrame> frame;
+            bool ok;
+            {
+              py::gil_scoped_release release;
+              ok = self.Read(frame, timeout_ms);
+            }
+            if (!ok) {
+              return py::none();
+            }
+
+            // The capsule keeps the frame mapped; freeing it releases the
+            // frame on the server.
+            py::capsule owner(new std::shared_ptr<ServerFrame>(frame),
+                              [](void *p) {
+                                delete reinterpret_cast<
+                                    std::shared_ptr<ServerFrame> *>(p);
+                              });
+            py::object image = shared_frame_to_numpy(frame->av, owner);
+            if (image.is_none()) {
+              return py::none();
+            }
+            py::dict meta;
+            meta["seq"] = frame->seq;
+            meta["frame_id"] = frame->frame_id;
+            meta["pts"] = frame->pts;
+            meta["time_seconds"] = frame->time_seconds;
+            return py::make_tuple(image, meta);
+          },
+          py::arg("timeout_ms") = -1,
+          "Waits for the next frame and returns (frame, info): a read-only "
+          "NumPy view of the frame memfd (a plane tuple for YUV) and a dict "
+          "with seq, frame_id, pts and time_seconds. The frame counts as "
+          "held until its views are gone. Returns None on timeout or at the "
+          "end of the stream.")
+      .def("close", &FrameClient::Close,
+           "Disconnects; frames still held stay valid.");
+
+  py::class_<ParallelVideo>(m, "ParallelVideo")
+      .def(py::init<const std::string &, const std::string &,
+                    const FFMPEGVideoOptions &, int, int, int>(),
+           py::arg("filename"), py::arg("filter_descr_str") = "",
+           py::arg("options") = FFMPEGVideoOptions(), py::arg("workers") = 4,
+           py::arg("chunks") = 0, py::arg("queue_frames") = 8,
+           py::call_guard<py::gil_scoped_release>(),
+           "Decodes one seekable file with several pipelines at once: the "
+           "file is split at keyframes into chunks (0 picks 4 per worker) "
+           "that worker threads decode ahead, each into a queue of up to "
+           "queue_frames frames.")
+      .def("is_initialized", &ParallelVideo::isInitialized)
+      .def(
+          "get_next_frame",
+          [](ParallelVideo &self) -> py::object {
+            VideoFrame frame;
+            bool ok;
+            {
+              py::gil_scoped_release release;
+              ok = self.GetNextFrame(frame);
+            }
+            if (!ok) {
+              return py::none();
+            }
+            return frame_to_python(frame);
+          },
+          "Retrieves the next frame in file order, like "
+          "FFMPEGVideo.get_next_frame(). Returns None at the end of the "
+          "file.")
+      .def("stop", &ParallelVideo::Stop,
+           py::call_guard<py::gil_scoped_release>(),
+           "Stops the workers; get_next_frame() returns None afterwards.")
+      .def("get_workers", &ParallelVideo::get_workers)
+      .def("get_chunks", &ParallelVideo::get_chunks)
+      .def("get_frame_total", &ParallelVideo::get_frame_total)
+      .def("get_frame_id", &ParallelVideo::get_frame_id,
+           "Returns the number of frames handed out so far.")
+      .def("get_buffered", &ParallelVideo::get_buffered,
+           "Returns the number of decoded frames waiting in the queues.")
+      .def("get_max_buffered", &ParallelVideo::get_max_buffered)
+      .def("get_failed_chunks", &ParallelVideo::get_failed_chunks,
+           "Returns the number of chunks that failed to decode; their "
+           "frames are missing from the output.");
+
+  py::class_<FrameBroadcaster>(m, "FrameBroadcaster")
+      .def(py::init<const std::string &, const std::string &,
+                    const FFMPEGVideoOptions &>(),
+           py::arg("filename"), py::arg("filter_descr_str") = "",
+           py::arg("options") = FFMPEGVideoOptions(),
+           "Creates a single decode/filter pipeline whose frames are shared "
+           "by all subscriptions.")
+      .def("is_initialized", &FrameBroadcaster::isInitialized)
+      .def("subscribe", &FrameBroadcaster::Subscribe, py::arg("capacity") = 4,
+           py::arg("policy") = DropPolicy::DropOldest,
+           py::arg("output_name") = "",
+           "Adds a consumer with its own bounded queue and drop policy.")
+      .def("start", &FrameBroadcaster::Start,
+           "Starts decoding on a background thread.")
+      .def("stop", &FrameBroadcaster::Stop,
+           py::call_guard<py::gil_scoped_release>(),
+           "Stops decoding and joins the background thread.")
+      .def("is_running", &FrameBroadcaster::isRunning)
+      .def("get_frame_count", &FrameBroadcaster::get_frame_count,
+           "Returns the number of frames decoded and broadcast so far.");
+
+  py::class_<LiveVideo>(m, "LiveVideo")
+      .def(py::init<const std::string &, const std::string &,
+                    const FFMPEGVideoOptions &, bool>(),
+           py::arg("filename"), py::arg("filter_descr_str") = "",
+           py::arg("options") = FFMPEGVideoOptions(),
+           py::arg("realtime") = false,
+           "Creates a latest-frame-only reader for live inputs. With "
+           "realtime=True the input is paced by its timestamps, like a live "
+           "camera.")
+      .def("is_initialized", &LiveVideo::isInitialized)
+      .def("start", &LiveVideo::Start,
+           "Starts decoding on a background thread.")
+      .def("stop", &LiveVideo::Stop, py::call_guard<py::gil_scoped_release>(),
+           "Stops decoding and joins the background thread.")
+      .def("is_running", &LiveVideo::isRunning)
+      .def(
+          "get_latest_frame",
+          [](LiveVideo &self, int timeout_ms) -> py::object {
+            VideoFrame frame;
+            bool ok;
+            {
+              py::gil_scoped_release release;
+              ok = self.GetLatestFrame(frame, timeout_ms);
+            }
+            if (!ok) {
+              return py::none();
+            }
+            return frame_to_numpy(frame);
+          },
+          py::arg("timeout_ms") = -1,
+          "Waits for a frame newer than the last one returned and converts "
+          "only that frame; frames the filter graph holds back do not end "
+          "the wait. Returns None on timeout or end of stream "
+          "(is_running() tells them apart).")
+      .def(
+          "get_latest_frames",
+          [](LiveVideo &self, int timeout_ms) -> py::object {
+            std::vector<VideoFrame> frames;
+            bool ok;
+            {
+              py::gil_scoped_release release;
+              ok = self.GetLatestFrames(frames, timeout_ms);
+            }
+            if (!ok) {
+              return py::none();
+            }
+            py::dict result;
+            const std::vector<std::string> &names =
+                self.get_video().get_output_names();
+            for (size_t i = 0; i < frames.size(); i++) {
+              result[py::str(names[i])] = frame_to_numpy(frames[i]);
+            }
+            return result;
+          },
+          py::arg("timeout_ms") = -1,
+          "Same as get_latest_frame(), returning all filter outputs as a "
+          "dict keyed by output name.")
+      .def(
+          "get_stats",
+          [](const LiveVideo &self) {
+            LiveVideoStats stats = self.get_stats();
+            py::dict result;
+            result["frames_decoded"] = stats.frames_decoded;
+            result["frames_delivered"] = stats.frames_delivered;
+            result["frames_superseded"] = stats.frames_superseded;
+            result["latency_last_ms"] = stats.latency_last_ms;
+            result["latency_avg_ms"] = stats.latency_avg_ms;
+            result["latency_max_ms"] = stats.latency_max_ms;
+            return result;
+          },
+          "Returns decode/delivery counters and capture-to-delivery latency.")
+      .def("reset_stats", &LiveVideo::reset_stats);
+
+  py::class_<IngestManager>(m, "IngestManager")
+      .def(py::init<int>(), py::arg("num_threads") = 4,
+           "Creates a manager running all camera inputs on a shared pool of "
+           "num_threads workers.")
+      .def("add_camera", &IngestManager::AddCamera, py::arg("cam_id"),
+           py::arg("filename"), py::arg("filter_descr_str") = "",
+           py::arg("options") = FFMPEGVideoOptions(),
+           py::arg("realtime") = false,
+           "Adds an input. With realtime=True a local file is paced by its "
+           "timestamps, like a live camera.")
+      .def("remove_camera", &IngestManager::RemoveCamera, py::arg("cam_id"))
+      .def("start", &IngestManager::Start, "Starts the worker threads.")
+      .def("stop", &IngestManager::Stop,
+           py::call_guard<py::gil_scoped_release>(),
+           "Stops and joins the worker threads.")
+      .def("is_running", &IngestManager::isRunning)
+      .def("get_camera_ids", &IngestManager::get_camera_ids)
+      .def("set_max_lag_ms", &IngestManager::set_max_lag_ms,
+           py::arg("max_lag_ms"),
+           "Frames decoded later than this skip conversion so the camera can "
+           "catch up.")
+      .def("set_reconnect_delay_ms", &IngestManager::set_reconnect_delay_ms,
+           py::arg("min_delay_ms"), py::arg("max_delay_ms"),
+           "Sets the exponential reconnect backoff range.")
+      .def(
+          "latest",
+          [](const IngestManager &self, const std::string &cam_id)
+              -> py::object {
+            VideoFrame frame;
+            if (!self.GetLatest(cam_id, frame)) {
+              return py::none();
+            }
+            return frame_to_numpy(frame);
+          },
+          py::arg("cam_id"),
+          "Returns the newest converted frame of a camera as a NumPy array, "
+          "or None if there is none yet.")
+      .def(
+          "get_stats",
+          [](const IngestManager &self) {
+            py::list table;
+            for (const CameraStats &stats : self.get_stats()) {
+              py::dict row;
+              row["cam_id"] = stats.cam_id;
+              row["connected"] = stats.connected;
+              row["fps"] = stats.fps;
+              row["latency_last_ms"] = stats.latency_last_ms;
+              row["latency_avg_ms"] = stats.latency_avg_ms;
+              row["frames_decoded"] = stats.frames_decoded;
+              row["frames_converted"] = stats.frames_converted;
+              row["frames_skipped"] = stats.frames_skipped;
+              row["reconnects"] = stats.reconnects;
+              table.append(row);
+            }
+            return table;
+          },
+          "Returns one dict per camera with FPS, latency and counters.");
 }
@@ -0,0 +1,51 @@
+#ifndef DLPACK_H
+#define DLPACK_H
+
+// The subset of the DLPack ABI (dlpack.h, v0.8, unversioned capsules) used to
+// hand frames to other frameworks without a copy. Layouts must match
+// https://github.com/dmlc/dlpack exactly.
+
+#include <stdint.h>
+
+extern "C" {
+
+typedef enum {
+  kDLCPU = 1,
+} DLDeviceType;
+
+typedef struct {
+  DLDeviceType device_type;
+  int32_t device_id;
+} DLDevice;
+
+typedef enum {
+  kDLInt = 0U,
+  kDLUInt = 1U,
+  kDLFloat = 2U,
+} DLDataTypeCode;
+
+typedef struct {
+  uint8_t code; // DLDataTypeCode
+  uint8_t bits;
+  uint16_t lanes;
+} DLDataType;
+
+typedef struct {
+  void *data;
+  DLDevice device;
+  int32_t ndim;
+  DLDataType dtype;
+  int64_t *shape;
+  int64_t *strides; // In elements, NULL for compact row-major
+  uint64_t byte_offset;
+} DLTensor;
+
+typedef struct DLManagedTensor {
+  DLTensor dl_tensor;
+  void *manager_ctx;
+  void (*deleter)(struct DLManagedTensor *self);
+} DLManagedTensor;
+
+} // extern "C"
+
+#endif // DLPACK_H
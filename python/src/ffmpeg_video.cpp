@@ -1,31 +1,91 @@
 #include "ffmpeg_video.h"
 
-static bool check_error(int ret, const std::string &msg) {
-  if (ret < 0) {
-    char errbuf[AV_ERROR_MAX_STRING_SIZE];
-    av_strerror(ret, errbuf, sizeof(errbuf));
-    std::cerr << msg << ": " << errbuf << std::endl;
-    return true; // Indicate error
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+extern "C" {
+#include <libavutil/video_enc_params.h>
+}
+
+#include "activity_scan.h"
+#include "av_error.h"
+
+// Frames to average over before the first degradation decision
+static const int kDegradeMinFrames = 25;
+// Open software decoders in the process, for the automatic thread count
+static std::atomic<int> active_sw_decoders(0);
+// Recent packet sizes kept for export_side_data, enough for any reordering
+static const size_t kPacketSizeHistory = 64;
+// Frames before a skip target from which the decoder stops discarding
+// non-reference frames, well beyond any reordering depth
+static const int kDiscardMargin = 32;
+
+// True when the filter description needs hardware frames or a hardware
+// device (hwmap, scale_rkrga, ...), so it cannot filter software frames.
+static bool needs_hw_frames(const std::string &descr) {
+  AVFilterGraph *graph = avfilter_graph_alloc();
+  AVFilterInOut *inputs = nullptr;
+  AVFilterInOut *outputs = nullptr;
+  bool hw = false;
+  if (graph &&
+      avfilter_graph_parse2(graph, descr.c_str(), &inputs, &outputs) >= 0) {
+    for (unsigned i = 0; i < graph->nb_filters; i++) {
+      const AVFilter *filter = graph->filters[i]->filter;
+      hw = hw || (filter->flags & AVFILTER_FLAG_HWDEVICE) ||
+           strncmp(filter->name, "hw", 2) == 0 ||
+           strstr(filter->name, "rkrga") != nullptr;
+    }
   }
-  return false; // Indicate success
+  avfilter_inout_free(&inputs);
+  avfilter_inout_free(&outputs);
+  avfilter_graph_free(&graph);
+  return hw;
 }
 
 // FFMPEGVideo Class Implementation
 FFMPEGVideo::FFMPEGVideo(const std::string &filename,
                          const std::string &filter_descr_str)
+    : FFMPEGVideo(filename, filter_descr_str, FFMPEGVideoOptions()) {}
+
+FFMPEGVideo::FFMPEGVideo(const std::string &filename,
+                         const std::string &filter_descr_str,
+                         const FFMPEGVideoOptions &options)
     : input_filename_(filename), filter_descr_(filter_descr_str),
-      fmt_ctx(nullptr), dec_ctx(nullptr), filter_graph(nullptr),
-      buffersrc_ctx(nullptr), buffersink_ctx(nullptr), hw_device_ctx(nullptr),
-      hw_frames_ctx(nullptr), pkt(nullptr), frame(nullptr), filt_frame(nullptr),
-      video_stream_idx(-1), initialized(false), frame_count_(0),
+      options_(options), fmt_ctx(nullptr), dec_ctx(nullptr),
+      filter_graph(nullptr), buffersrc_ctx(nullptr), hw_device_ctx(nullptr),
+      hw_frames_ctx(nullptr), pkt(nullptr), frame(nullptr),
+      video_stream_idx(-1), initialized(false), pkt_pending_(false),
+      input_would_block_(false), hw_decoding_(false), session_wait_ms_(0.0),
+      filter_hw_input_(false), switch_requested_(false),
+      switch_draining_(false), decode_busy_us_(0), decode_latency_ms_(0.0),
+      frames_since_switch_(0), last_switch_us_(0), hw_to_sw_switches_(0),
+      sw_to_hw_switches_(0), counts_as_sw_decoder_(false), filter_busy_us_(0),
+      filter_frames_(0), has_last_stats_(false), stats_dropped_(0),
+      crop_frame_(nullptr), has_last_info_(false),
+      seek_min_pts_(AV_NOPTS_VALUE), end_frame_(-1),
+      sample_seekable_(-1), sample_prev_time_(0.0), has_sample_prev_(false),
+      frame_count_(0),
       total_frames_(0), video_width_(0), video_height_(0), frame_width_(0),
       frame_height_(0), video_time_base_({0, 1}),
       current_frame_pts_(AV_NOPTS_VALUE), current_frame_time_seconds_(0.0) {
+  output_names_ = options_.output_names;
+  if (output_names_.empty()) {
+    output_names_.push_back("out");
+  }
+
   pkt = av_packet_alloc();
   frame = av_frame_alloc();
-  filt_frame = av_frame_alloc();
+  bool allocated = pkt && frame;
+  for (size_t i = 0; i < output_names_.size(); i++) {
+    filt_frames.push_back(av_frame_alloc());
+    allocated = allocated && filt_frames.back();
+  }
 
-  if (!pkt || !frame || !filt_frame) {
+  if (!allocated) {
     std::cerr << "Failed to allocate AVPacket or AVFrame. Out of memory?"
               << std::endl;
     return;
@@ -38,22 +98,37 @@ FFMPEGVideo::~FFMPEGVideo() { cleanup(); }
 
 bool FFMPEGVideo::isInitialized() const { return initialized; }
 
-// Private helper function to handle a successfully retrieved filtered frame.
-bool FFMPEGVideo::process_retrieved_frame(cv::Mat &output_mat_ref) {
+bool FFMPEGVideo::isWaitingForInput() const { return input_would_block_; }
+
+// Moves the reference held by 'src' into a new shared frame.
+static std::shared_ptr<AVFrame> make_frame_ref(AVFrame *src) {
+  AVFrame *dst = av_frame_alloc();
+  if (!dst) {
+    return nullptr;
+  }
+  av_frame_move_ref(dst, src);
+  return std::shared_ptr<AVFrame>(dst, [](AVFrame *f) { av_frame_free(&f); });
+}
+
+bool FFMPEGVideo::FrameToMat(const AVFrame *src, cv::Mat &output_mat) {
 
   // Determine the OpenCV matrix type based on the pixel format
   int cv_type;
-  // Explicitly cast filt_frame->format to AVPixelFormat to resolve the error
+  // Explicitly cast src->format to AVPixelFormat to resolve the error
   const AVPixFmtDescriptor *desc =
-      av_pix_fmt_desc_get(static_cast<AVPixelFormat>(filt_frame->format));
+      av_pix_fmt_desc_get(static_cast<AVPixelFormat>(src->format));
   if (!desc) {
-    std::cerr << "Unknown pixel format: " << filt_frame->format << std::endl;
+    std::cerr << "Unknown pixel format: " << src->format << std::endl;
     return false;
   }
 #if !NDEBUG
   std::cout << "Detected output pixel format: " << desc->name << std::endl;
 #endif
-  if (desc->nb_components == 1) { // Grayscale
+  if (desc->log2_chroma_w || desc->log2_chroma_h) {
+    std::cerr << "Subsampled " << desc->name
+              << " frames only convert to planes (FrameToPlanes)." << std::endl;
+    return false;
+  } else if (desc->nb_components == 1) { // Grayscale
     cv_type = CV_8UC1;
   } else if (desc->nb_components == 3) { // Color (e.g., BGR24)
     cv_type = CV_8UC3;
@@ -63,182 +138,1100 @@ bool FFMPEGVideo::process_retrieved_frame(cv::Mat &output_mat_ref) {
     return false;
   }
 
-  output_mat_ref = cv::Mat(filt_frame->height, filt_frame->width, cv_type,
-                           filt_frame->data[0], filt_frame->linesize[0]);
+  output_mat = cv::Mat(src->height, src->width, cv_type, src->data[0],
+                       src->linesize[0]);
+  return true;
+}
+
+bool FFMPEGVideo::FrameToPlanes(const AVFrame *src,
+                                std::vector<cv::Mat> &planes) {
+  int chroma_width = (src->width + 1) / 2;
+  int chroma_height = (src->height + 1) / 2;
+  planes.clear();
+  switch (src->format) {
+  case AV_PIX_FMT_NV12:
+  case AV_PIX_FMT_NV21:
+    planes.emplace_back(src->height, src->width, CV_8UC1, src->data[0],
+                        src->linesize[0]);
+    planes.emplace_back(chroma_height, chroma_width, CV_8UC2, src->data[1],
+                        src->linesize[1]);
+    return true;
+  case AV_PIX_FMT_YUV420P:
+  case AV_PIX_FMT_YUVJ420P:
+    planes.emplace_back(src->height, src->width, CV_8UC1, src->data[0],
+                        src->linesize[0]);
+    planes.emplace_back(chroma_height, chroma_width, CV_8UC1, src->data[1],
+                        src->linesize[1]);
+    planes.emplace_back(chroma_height, chroma_width, CV_8UC1, src->data[2],
+                        src->linesize[2]);
+    return true;
+  default:
+    return false;
+  }
+}
 
+// Private helper function to handle a successfully retrieved filtered frame.
+void FFMPEGVideo::process_retrieved_frame(const AVFrame *src) {
   if (frame_count_ == 0) { // Only set once for first frame
-    frame_width_ = filt_frame->width;
-    frame_height_ = filt_frame->height;
+    frame_width_ = src->width;
+    frame_height_ = src->height;
   }
   frame_count_++;
 
-  current_frame_pts_ = filt_frame->pts;
+  current_frame_pts_ = src->pts;
   if (video_time_base_.num != 0 && video_time_base_.den != 0) {
     current_frame_time_seconds_ = current_frame_pts_ * av_q2d(video_time_base_);
   } else {
     current_frame_time_seconds_ = 0.0;
   }
+  if (!options_.shm_ring_name.empty()) {
+    publish_frame(src);
+  }
+}
+
+// Copies the output frame into the shared memory ring, created on the first
+// frame.
+void FFMPEGVideo::publish_frame(const AVFrame *src) {
+  if (!frame_ring_) {
+    frame_ring_.reset(new FrameRingWriter());
+    int size = av_image_get_buffer_size(static_cast<AVPixelFormat>(src->format),
+                                        src->width, src->height, 1);
+    if (size <= 0 ||
+        !frame_ring_->Create(
+            options_.shm_ring_name, options_.shm_ring_slots,
+            std::max<int64_t>(size, options_.shm_ring_slot_size))) {
+      std::cerr << "Frame ring disabled." << std::endl;
+    }
+  }
+  if (frame_ring_->isOpen()) {
+    frame_ring_->Write(src, frame_count_, current_frame_time_seconds_);
+  }
+}
+
+// Pulls the next decoded frame into 'frame' and keeps track of the time
+// spent inside the decoder (demuxing excluded).
+int FFMPEGVideo::decode_next_frame() {
+  int64_t start_us = av_gettime_relative();
+  int64_t read_us = 0;
+  input_would_block_ = false; // Only set by this call's reads
+  int ret = receive_next_frame(start_us, read_us);
+  // Leading frames of an open GOP, decoded before the keyframe sought to.
+  while (ret == 0 && seek_min_pts_ != AV_NOPTS_VALUE) {
+    if (frame->pts == AV_NOPTS_VALUE || frame->pts >= seek_min_pts_) {
+      seek_min_pts_ = AV_NOPTS_VALUE;
+      break;
+    }
+    av_frame_unref(frame);
+    ret = receive_next_frame(start_us, read_us);
+  }
+  decode_busy_us_ += av_gettime_relative() - start_us - read_us;
+  if (ret == 0) {
+    update_decode_latency();
+  }
+  return ret;
+}
+
+// Reads and sends packets as needed until the decoder returns a frame.
+int FFMPEGVideo::receive_next_frame(int64_t &start_us, int64_t &read_us) {
+  while (true) {
+    int ret = avcodec_receive_frame(dec_ctx, frame);
+    if (ret >= 0) {
+      frame->pts = frame->best_effort_timestamp;
+      return 0;
+    } else if (ret == AVERROR_EOF && switch_draining_) {
+      // Old decoder drained, the held keyframe goes to the new one.
+      if (!switch_decoder()) {
+        return AVERROR(EINVAL);
+      }
+      start_us = av_gettime_relative();
+      read_us = 0;
+      continue;
+    } else if (ret == AVERROR_EOF) {
+      return ret;
+    } else if (ret != AVERROR(EAGAIN)) {
+      check_error(ret, "Error receiving frame from decoder");
+      return ret;
+    } else if (switch_draining_) {
+      av_usleep(1000); // Hardware still finishing the flushed frames
+      continue;
+    }
+
+    // Decoder needs more packets. Read one unless a refused one is pending.
+    if (!pkt_pending_) {
+      int64_t read_start_us = av_gettime_relative();
+      ret = av_read_frame(fmt_ctx, pkt);
+      read_us += av_gettime_relative() - read_start_us;
+      input_would_block_ = (ret == AVERROR(EAGAIN));
+      if (input_would_block_) {
+        return ret; // Non-blocking input has no packet ready yet
+      } else if (ret == AVERROR_EOF) {
+#if !NDEBUG
+        std::cout << "Initiating decoder flushing..." << std::endl;
+#endif
+        // Enter draining mode, the decoder returns AVERROR_EOF once empty.
+        ret = avcodec_send_packet(dec_ctx, nullptr);
+        if (ret < 0 && ret != AVERROR_EOF) {
+          check_error(ret, "Error flushing decoder");
+          return ret;
+        }
+        continue;
+      } else if (check_error(ret, "Error reading packet from input")) {
+        return ret;
+      }
+      if (pkt->stream_index != video_stream_idx) {
+        av_packet_unref(pkt);
+        continue;
+      }
+      if (options_.export_side_data) {
+        packet_sizes_.emplace_back(
+            pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts, pkt->size);
+        if (packet_sizes_.size() > kPacketSizeHistory) {
+          packet_sizes_.pop_front();
+        }
+      }
+      if (switch_requested_ && (pkt->flags & AV_PKT_FLAG_KEY)) {
+        // Switch decoders at this keyframe: hold it and drain the current
+        // decoder first, so no frame is lost or decoded twice.
+        pkt_pending_ = true;
+        switch_draining_ = true;
+        ret = avcodec_send_packet(dec_ctx, nullptr);
+        if (check_error(ret, "Error draining decoder for switch")) {
+          return ret;
+        }
+        continue;
+      }
+    }
+
+    ret = avcodec_send_packet(dec_ctx, pkt);
+    if (ret == AVERROR(EAGAIN)) {
+      // Decoder is full but produced no frame yet (busy HW), retry shortly.
+      if (pkt_pending_) {
+        av_usleep(1000);
+      }
+      pkt_pending_ = true;
+      continue;
+    }
+    pkt_pending_ = false;
+    av_packet_unref(pkt);
+    if (check_error(ret, "Error sending packet to decoder")) {
+      return ret;
+    }
+  }
+}
+
+// Updates the decoder latency average with the time spent on the frame just
+// decoded, and decides whether to switch decoders at the next keyframe.
+void FFMPEGVideo::update_decode_latency() {
+  double sample_ms = decode_busy_us_ / 1000.0;
+  decode_busy_us_ = 0;
+  frames_since_switch_++;
+  decode_latency_ms_ = frames_since_switch_ == 1
+                           ? sample_ms
+                           : 0.9 * decode_latency_ms_ + 0.1 * sample_ms;
+
+  if (options_.degrade_latency_ms <= 0.0 || options_.force_software ||
+      switch_requested_) {
+    return;
+  }
+  if (hw_decoding_) {
+    if (frames_since_switch_ >= kDegradeMinFrames &&
+        decode_latency_ms_ > options_.degrade_latency_ms) {
+#if !NDEBUG
+      std::cout << "Hardware decode latency " << decode_latency_ms_
+                << "ms, switching to software at the next keyframe."
+                << std::endl;
+#endif
+      switch_requested_ = true;
+    }
+    return;
+  }
+
+  // On software: retry the hardware decoder once in a while.
+  int64_t now_us = av_gettime_relative();
+  if (now_us - last_switch_us_ < options_.recover_after_ms * 1000LL) {
+    return;
+  }
+  if (!session_ticket_) {
+    session_ticket_ = HwSessionGovernor::instance().Acquire(
+        options_.session_priority, 0);
+  }
+  if (session_ticket_) {
+    switch_requested_ = true;
+  } else {
+    last_switch_us_ = now_us; // No free session, try again later
+  }
+}
+
+// Replaces the drained decoder by the other kind. A failed hardware open
+// stays on (or returns to) software decoding.
+bool FFMPEGVideo::switch_decoder() {
+  HwSessionGovernor &governor = HwSessionGovernor::instance();
+  bool was_hw = hw_decoding_;
+  free_decoder();
 
-  av_frame_unref(filt_frame);
+  hw_decoding_ = !was_hw && init_hw_decoder();
+  if (!was_hw && !hw_decoding_) {
+    governor.record_hw_open_failure();
+    free_decoder();
+  }
+  if (!hw_decoding_) {
+    if (!governor.governs_software()) {
+      session_ticket_.reset();
+    }
+    if (!init_sw_decoder()) {
+      return false;
+    }
+  }
+
+  if (hw_decoding_ != was_hw) {
+    (hw_decoding_ ? sw_to_hw_switches_ : hw_to_sw_switches_)++;
+  }
+#if !NDEBUG
+  std::cout << "Switched to " << (hw_decoding_ ? "hardware" : "software")
+            << " decoding." << std::endl;
+#endif
+  switch_requested_ = false;
+  switch_draining_ = false;
+  frames_since_switch_ = 0;
+  decode_latency_ms_ = 0.0;
+  decode_busy_us_ = 0;
+  last_switch_us_ = av_gettime_relative();
   return true;
 }
 
 bool FFMPEGVideo::GetNextFrame(cv::Mat &output_mat) {
+  std::vector<cv::Mat> output_mats;
+  if (!GetNextFrames(output_mats)) {
+    return false;
+  }
+  output_mat = output_mats[0];
+  return true;
+}
+
+bool FFMPEGVideo::GetNextFrames(std::vector<cv::Mat> &output_mats) {
+  if (!unget_frames_.empty()) {
+    unget_frames_.clear(); // filt_frames still holds them
+  } else if (!pull_next_frames()) {
+    return false;
+  }
+  // The Mats reference filt_frames, released on the next call.
+  output_mats.resize(filt_frames.size());
+  for (size_t i = 0; i < filt_frames.size(); i++) {
+    if (!FrameToMat(filt_frames[i], output_mats[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FFMPEGVideo::GetNextFrame(VideoFrame &output_frame) {
+  std::vector<VideoFrame> output_frames;
+  if (!GetNextFrames(output_frames)) {
+    return false;
+  }
+  output_frame = output_frames[0];
+  return true;
+}
+
+bool FFMPEGVideo::GetNextFrames(std::vector<VideoFrame> &output_frames) {
+  if (!unget_frames_.empty()) {
+    output_frames.swap(unget_frames_);
+    unget_frames_.clear();
+    return true;
+  }
+  if (!pull_next_frames()) {
+    return false;
+  }
+  return export_frames(output_frames);
+}
+
+void FFMPEGVideo::UngetFrames(const std::vector<VideoFrame> &frames) {
+  unget_frames_ = frames;
+}
+
+bool FFMPEGVideo::DecodeFrame(std::shared_ptr<AVFrame> &decoded_frame) {
+  if (!initialized) {
+    std::cerr << "FFMPEGVideo not initialized. Cannot decode frame."
+              << std::endl;
+    return false;
+  }
+  if (decode_next_frame() < 0) {
+    return false;
+  }
+  decoded_frame = make_frame_ref(frame);
+  return decoded_frame != nullptr;
+}
+
+int FFMPEGVideo::FilterFrame(const AVFrame *decoded_frame,
+                             std::vector<VideoFrame> &output_frames) {
+  std::lock_guard<std::mutex> lock(filter_mutex_);
+  if (!initialized) {
+    std::cerr << "FFMPEGVideo not initialized. Cannot filter frame."
+              << std::endl;
+    return AVERROR(EINVAL);
+  }
+
+  for (AVFrame *filt_frame : filt_frames) {
+    av_frame_unref(filt_frame);
+  }
+  if (!pass_frame_gates(decoded_frame)) {
+    frame_count_++;
+    return AVERROR(EAGAIN); // Dropped before conversion
+  }
+
+  if (frame_converter_) {
+    if (!convert_frame(decoded_frame)) {
+      return AVERROR_EXTERNAL;
+    }
+  } else if (!feed_filter_graph(decoded_frame)) {
+    return AVERROR_EXTERNAL;
+  } else if (!take_flushed_frames()) {
+    int ret = receive_filtered_frames();
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+      return AVERROR(EAGAIN); // Filter graph buffered or dropped this frame
+    } else if (check_error(ret, "Error receiving frame from filter graph")) {
+      return ret;
+    }
+  }
+
+  process_retrieved_frame(filt_frames[0]);
+  return export_frames(output_frames) ? 0 : AVERROR(ENOMEM);
+}
+
+// Releases 'frame', keeping it as last_decoded_ with the keep_decoded option
+// and its info with export_side_data.
+void FFMPEGVideo::keep_decoded_frame() {
+  if (options_.keep_decoded) {
+    last_decoded_ = make_frame_ref(frame);
+  }
+  if (options_.export_side_data) {
+    has_last_info_ = GetFrameInfo(frame, last_info_);
+  }
+  av_frame_unref(frame);
+}
+
+bool FFMPEGVideo::GetFrameInfo(const AVFrame *decoded_frame,
+                               CompressedFrameInfo &info) const {
+  if (!options_.export_side_data) {
+    return false;
+  }
+  info = CompressedFrameInfo();
+  info.pts = decoded_frame->pts;
+  info.pict_type = av_get_picture_type_char(decoded_frame->pict_type);
+  info.key_frame = (decoded_frame->flags & AV_FRAME_FLAG_KEY) != 0;
+  for (const std::pair<int64_t, int> &packet : packet_sizes_) {
+    if (packet.first == decoded_frame->pts) {
+      info.packet_size = packet.second;
+      break;
+    }
+  }
+
+  const AVFrameSideData *side_data =
+      av_frame_get_side_data(decoded_frame, AV_FRAME_DATA_MOTION_VECTORS);
+  if (side_data) {
+    const AVMotionVector *mvs =
+        reinterpret_cast<const AVMotionVector *>(side_data->data);
+    info.motion_vectors.assign(
+        mvs, mvs + side_data->size / sizeof(AVMotionVector));
+  }
+  if (!hw_decoding_) {
+    info.motion = static_cast<float>(MotionScore(decoded_frame));
+  }
+
+  side_data =
+      av_frame_get_side_data(decoded_frame, AV_FRAME_DATA_VIDEO_ENC_PARAMS);
+  if (side_data) {
+    AVVideoEncParams *params =
+        reinterpret_cast<AVVideoEncParams *>(side_data->data);
+    if (params->nb_blocks == 0) {
+      info.qp_mean = static_cast<float>(params->qp);
+      info.qp_min = info.qp_max = params->qp;
+    } else {
+      double sum = 0.0;
+      double area = 0.0;
+      info.qp_min = INT32_MAX;
+      info.qp_max = INT32_MIN;
+      for (unsigned int i = 0; i < params->nb_blocks; i++) {
+        const AVVideoBlockParams *block = av_video_enc_params_block(params, i);
+        int qp = params->qp + block->delta_qp;
+        sum += static_cast<double>(qp) * block->w * block->h;
+        area += static_cast<double>(block->w) * block->h;
+        info.qp_min = std::min(info.qp_min, qp);
+        info.qp_max = std::max(info.qp_max, qp);
+      }
+      info.qp_mean = static_cast<float>(area > 0 ? sum / area : params->qp);
+    }
+  }
+  return true;
+}
+
+bool FFMPEGVideo::GetLastFrameStats(FrameStats &stats) const {
+  if (!has_last_stats_) {
+    return false;
+  }
+  stats = last_stats_;
+  return true;
+}
+
+bool FFMPEGVideo::GetLastFrameInfo(CompressedFrameInfo &info) const {
+  if (!has_last_info_) {
+    return false;
+  }
+  info = last_info_;
+  return true;
+}
+
+bool FFMPEGVideo::GetDecodedFrame(VideoFrame &decoded_frame) const {
+  if (!last_decoded_) {
+    return false;
+  }
+  decoded_frame.av = last_decoded_;
+  decoded_frame.frame_id = frame_count_;
+  decoded_frame.pts = last_decoded_->pts;
+  decoded_frame.time_seconds = 0.0;
+  if (video_time_base_.num != 0 && video_time_base_.den != 0 &&
+      last_decoded_->pts != AV_NOPTS_VALUE) {
+    decoded_frame.time_seconds =
+        last_decoded_->pts * av_q2d(video_time_base_);
+  }
+  return true;
+}
+
+bool FFMPEGVideo::GetCrops(const AVFrame *decoded_frame,
+                           const std::vector<CropBox> &boxes, int width,
+                           int height, AVPixelFormat format, uint8_t *dst) {
+  if (width <= 0 || height <= 0 ||
+      (format != AV_PIX_FMT_BGR24 && format != AV_PIX_FMT_RGB24)) {
+    std::cerr << "Crops need a positive size and bgr24 or rgb24."
+              << std::endl;
+    return false;
+  }
+  const AVFrame *src = decoded_frame;
+  if (decoded_frame->hw_frames_ctx) {
+    if (!crop_frame_ && !(crop_frame_ = av_frame_alloc())) {
+      std::cerr << "Failed to allocate AVFrame. Out of memory?" << std::endl;
+      return false;
+    }
+    av_frame_unref(crop_frame_);
+    int ret = av_hwframe_transfer_data(crop_frame_, decoded_frame, 0);
+    if (check_error(ret, "Failed to download hardware frame")) {
+      return false;
+    }
+    crop_frame_->colorspace = decoded_frame->colorspace;
+    crop_frame_->color_range = decoded_frame->color_range;
+    src = crop_frame_;
+  }
+
+  int out_width = 0, out_height = 0;
+  if (crop_converter_) {
+    crop_converter_->get_output_size(width, height, out_width, out_height);
+  }
+  if (!crop_converter_ || out_width != width || out_height != height ||
+      crop_converter_->get_format() != format) {
+    bool bilinear = options_.resize_filter == "bilinear";
+    crop_converter_.reset(new YuvConverter(width, height, format, bilinear));
+  }
+
+  size_t crop_bytes = static_cast<size_t>(width) * height * 3;
+  for (size_t i = 0; i < boxes.size(); i++) {
+    // 4:2:0 chroma needs an even origin.
+    const CropBox &box = boxes[i];
+    int x1 = std::min(std::max(box.x1, 0), src->width - 1) & ~1;
+    int y1 = std::min(std::max(box.y1, 0), src->height - 1) & ~1;
+    int x2 = std::min(std::max(box.x2, x1 + 1), src->width);
+    int y2 = std::min(std::max(box.y2, y1 + 1), src->height);
+    if (!crop_converter_->ConvertRegion(src, x1, y1, x2 - x1, y2 - y1,
+                                        dst + i * crop_bytes, width * 3)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Packet timestamps (display order) and keyframes of the video stream of
+// filename, read without decoding.
+static bool scan_packets(const std::string &filename, int stream_idx,
+                         std::vector<int64_t> &timestamps,
+                         std::vector<KeyframeEntry> &keyframes) {
+  AVFormatContext *scan_ctx = nullptr;
+  int ret = avformat_open_input(&scan_ctx, filename.c_str(), nullptr, nullptr);
+  if (check_error(ret, "Failed to open input for the keyframe scan")) {
+    return false;
+  }
+  AVPacket *scan_pkt = av_packet_alloc();
+  ret = scan_pkt ? 0 : AVERROR(ENOMEM);
+  while (ret >= 0 && (ret = av_read_frame(scan_ctx, scan_pkt)) >= 0) {
+    if (scan_pkt->stream_index == stream_idx) {
+      int64_t ts =
+          scan_pkt->pts != AV_NOPTS_VALUE ? scan_pkt->pts : scan_pkt->dts;
+      if (scan_pkt->flags & AV_PKT_FLAG_KEY) {
+        keyframes.push_back({0, ts, scan_pkt->pos});
+      }
+      timestamps.push_back(ts);
+    }
+    av_packet_unref(scan_pkt);
+  }
+  av_packet_free(&scan_pkt);
+  avformat_close_input(&scan_ctx);
+  return ret == AVERROR_EOF ||
+         !check_error(ret, "Failed to read input for the keyframe scan");
+}
+
+bool FFMPEGVideo::GetKeyframeIndex(std::vector<KeyframeEntry> &keyframes) {
+  if (!keyframes_.empty()) {
+    keyframes = keyframes_;
+    return true;
+  }
+  if (!initialized || !fmt_ctx->pb ||
+      !(fmt_ctx->pb->seekable & AVIO_SEEKABLE_NORMAL)) {
+    std::cerr << "Keyframe index needs a seekable input." << std::endl;
+    return false;
+  }
+  std::vector<int64_t> timestamps;
+  std::vector<KeyframeEntry> scanned;
+  if (!scan_packets(input_filename_, video_stream_idx, timestamps, scanned)) {
+    return false;
+  }
+  if (scanned.empty()) {
+    std::cerr << "No keyframes found in " << input_filename_ << std::endl;
+    return false;
+  }
+  // Index in display order: the frames with an earlier timestamp.
+  std::sort(timestamps.begin(), timestamps.end());
+  for (KeyframeEntry &keyframe : scanned) {
+    keyframe.frame_index = static_cast<int>(
+        std::lower_bound(timestamps.begin(), timestamps.end(), keyframe.pts) -
+        timestamps.begin());
+  }
+  std::sort(scanned.begin(), scanned.end(),
+            [](const KeyframeEntry &a, const KeyframeEntry &b) {
+              return a.frame_index < b.frame_index;
+            });
+  keyframes_ = scanned;
+  frame_pts_ = timestamps;
+  total_frames_ = static_cast<int>(timestamps.size());
+  keyframes = keyframes_;
+  return true;
+}
+
+bool FFMPEGVideo::GetFrameTimestamps(std::vector<int64_t> &timestamps) {
+  std::vector<KeyframeEntry> keyframes;
+  if (!GetKeyframeIndex(keyframes)) {
+    return false;
+  }
+  timestamps = frame_pts_;
+  return true;
+}
+
+void FFMPEGVideo::SetKeyframeIndex(const std::vector<KeyframeEntry> &keyframes,
+                                   const std::vector<int64_t> &timestamps) {
+  keyframes_ = keyframes;
+  frame_pts_ = timestamps;
+  total_frames_ = static_cast<int>(timestamps.size());
+}
+
+// Drops all decoder, filter and output state, e.g. after a seek.
+void FFMPEGVideo::reset_pipeline() {
+  av_packet_unref(pkt);
+  pkt_pending_ = false;
+  switch_requested_ = false;
+  switch_draining_ = false;
+  input_would_block_ = false;
+  avcodec_flush_buffers(dec_ctx);
+  av_frame_unref(frame);
+  packet_sizes_.clear();
+  if (dedup_) {
+    dedup_->Reset();
+  }
+  reset_filter_graph();
+}
+
+// Drops the frames buffered after the decoder.
+void FFMPEGVideo::reset_filter_graph() {
+  for (AVFrame *filt_frame : filt_frames) {
+    av_frame_unref(filt_frame);
+  }
+  unget_frames_.clear();
+  flushed_frames_.clear();
+  last_decoded_.reset();
+  has_last_info_ = false;
+  has_last_stats_ = false;
+  if (filter_graph) {
+    avfilter_graph_free(&filter_graph);
+    buffersrc_ctx = nullptr;
+    buffersink_ctxs.clear();
+    initialized = init_filter_graph();
+  }
+}
+
+bool FFMPEGVideo::SeekToFrame(int frame_index) {
+  return seek_to_frame(frame_index, true);
+}
+
+// Without reset_graph, frames still buffered in the filter graph stay there
+// when decoding forward (the skipped frames never enter it).
+bool FFMPEGVideo::seek_to_frame(int frame_index, bool reset_graph) {
+  std::vector<KeyframeEntry> keyframes;
+  if (!GetKeyframeIndex(keyframes)) {
+    return false;
+  }
+  frame_index = std::max(frame_index, 0);
+  // Last keyframe at or before the target.
+  auto keyframe = std::upper_bound(
+      keyframes.begin(), keyframes.end(), frame_index,
+      [](int index, const KeyframeEntry &entry) {
+        return index < entry.frame_index;
+      });
+  if (keyframe != keyframes.begin()) {
+    --keyframe;
+  }
+
+  if (keyframe->frame_index <= frame_count_ && frame_count_ <= frame_index) {
+    // No keyframe in between: decoding on is cheaper than seeking back.
+    if (reset_graph) {
+      reset_filter_graph();
+    }
+    return initialized && skip_to_frame(frame_index);
+  }
+
+  int ret = av_seek_frame(fmt_ctx, video_stream_idx, keyframe->pts,
+                          AVSEEK_FLAG_BACKWARD);
+  if (check_error(ret, "Failed to seek")) {
+    return false;
+  }
+  reset_pipeline();
+  if (!initialized) {
+    return false;
+  }
+  seek_min_pts_ = keyframe->pts;
+  frame_count_ = keyframe->frame_index;
+  if (!skip_to_frame(frame_index)) {
+    return false;
+  }
+#if !NDEBUG
+  std::cout << "Seeked to frame " << frame_index << " from keyframe "
+            << keyframe->frame_index << std::endl;
+#endif
+  return true;
+}
+
+bool FFMPEGVideo::SetFrameRange(int start, int end) {
+  if (end >= 0 && end < start) {
+    std::cerr << "Invalid frame range [" << start << ", " << end << ")."
+              << std::endl;
+    return false;
+  }
+  if (start != frame_count_ && !SeekToFrame(start)) {
+    return false;
+  }
+  end_frame_ = end;
+  return true;
+}
+
+// Decodes and drops the frames up to frame_index, without filtering. Far
+// from it the decoder discards non-reference frames (hardware decoders
+// ignore the hint), the position then following the timestamps of the
+// frames still coming out.
+bool FFMPEGVideo::skip_to_frame(int frame_index) {
+  bool indexed = false; // Last frame found in frame_pts_
+  bool ok = true;
+  while (frame_count_ < frame_index) {
+    dec_ctx->skip_frame = indexed && frame_index - frame_count_ > kDiscardMargin
+                              ? AVDISCARD_NONREF
+                              : AVDISCARD_DEFAULT;
+    if (decode_next_frame() < 0) {
+      ok = false;
+      break;
+    }
+    int index = frame_index_of(frame->pts);
+    indexed = index >= frame_count_;
+    frame_count_ = indexed ? index + 1 : frame_count_ + 1;
+    av_frame_unref(frame);
+  }
+  dec_ctx->skip_frame = AVDISCARD_DEFAULT;
+  return ok;
+}
+
+// Display index of the frame with this timestamp, -1 if not indexed.
+int FFMPEGVideo::frame_index_of(int64_t pts) const {
+  auto it = std::lower_bound(frame_pts_.begin(), frame_pts_.end(), pts);
+  if (pts == AV_NOPTS_VALUE || it == frame_pts_.end() || *it != pts) {
+    return -1;
+  }
+  return static_cast<int>(it - frame_pts_.begin());
+}
+
+// False at the end of the frame range, past the last of the frame_ranges
+// option or past the last sample; else moves on to the next frame in range
+// and, sampling by frame index, to the next sample.
+bool FFMPEGVideo::next_frame_allowed() {
+  while (true) {
+    if (end_frame_ >= 0 && frame_count_ >= end_frame_) {
+      return false; // End of the frame range
+    }
+    if (!options_.frame_ranges.empty() && !enter_frame_range()) {
+      return false;
+    }
+    if (!sample_by_index()) {
+      // Decoding on, unless past the last sample timestamp.
+      return !sampling() || options_.sample_every_n > 1 || !has_sample_prev_ ||
+             !isnan(next_sample_time(sample_prev_time_));
+    }
+    int sample = next_sample_index();
+    if (sample < 0) {
+      return false;
+    } else if (sample == frame_count_) {
+      return true;
+    } else if (!seek_to_frame(sample, false)) {
+      return false;
+    }
+  }
+}
+
+bool FFMPEGVideo::sampling() const {
+  return options_.sample_every_n > 1 || options_.sample_target_fps > 0 ||
+         !options_.sample_timestamps.empty();
+}
+
+// Sampling with a keyframe index, checked for on the first sampled read.
+bool FFMPEGVideo::sample_by_index() {
+  if (!sampling()) {
+    return false;
+  }
+  if (sample_seekable_ < 0) {
+    std::vector<KeyframeEntry> keyframes;
+    sample_seekable_ = fmt_ctx->pb &&
+                       (fmt_ctx->pb->seekable & AVIO_SEEKABLE_NORMAL) &&
+                       GetKeyframeIndex(keyframes);
+  }
+  return sample_seekable_ > 0;
+}
+
+// First sample time (seconds) after previous, NAN past the last one.
+double FFMPEGVideo::next_sample_time(double previous) const {
+  if (options_.sample_target_fps > 0) {
+    if (!isfinite(previous)) {
+      return previous;
+    }
+    // Slightly early, for frames right on the grid despite rounding.
+    double fps = options_.sample_target_fps;
+    return (floor(previous * fps + 1e-6) + 1 - 1e-6) / fps;
+  }
+  const std::vector<double> &times = options_.sample_timestamps;
+  auto next = std::upper_bound(times.begin(), times.end(), previous);
+  return next != times.end() ? *next : NAN;
+}
+
+// Display index of the next sampled frame from frame_count_ on, -1 past the
+// last one.
+int FFMPEGVideo::next_sample_index() const {
+  if (options_.sample_every_n > 1) {
+    int n = options_.sample_every_n;
+    int index = (frame_count_ + n - 1) / n * n;
+    return index < total_frames_ ? index : -1;
+  }
+  if (frame_count_ >= total_frames_) {
+    return -1;
+  }
+  double time_base = av_q2d(video_time_base_);
+  double previous =
+      frame_count_ > 0 ? frame_pts_[frame_count_ - 1] * time_base : -INFINITY;
+  double time = next_sample_time(previous);
+  if (isnan(time)) {
+    return -1;
+  }
+  auto next = std::lower_bound(
+      frame_pts_.begin(), frame_pts_.end(), time,
+      [time_base](int64_t pts, double t) { return pts * time_base < t; });
+  return next != frame_pts_.end()
+             ? static_cast<int>(next - frame_pts_.begin())
+             : -1;
+}
+
+// False for a decoded frame that is not sampled. Without a keyframe index,
+// decides by the frame itself.
+bool FFMPEGVideo::sample_wanted(const AVFrame *decoded_frame) {
+  if (!sampling()) {
+    return true;
+  } else if (sample_seekable_ > 0) {
+    return next_sample_index() == frame_count_;
+  }
+  if (options_.sample_every_n > 1) {
+    return frame_count_ % options_.sample_every_n == 0;
+  }
+  if (decoded_frame->pts == AV_NOPTS_VALUE) {
+    return true;
+  }
+  double time = decoded_frame->pts * av_q2d(video_time_base_);
+  double next = next_sample_time(has_sample_prev_ ? sample_prev_time_
+                                                  : -INFINITY);
+  sample_prev_time_ = time;
+  has_sample_prev_ = true;
+  return time >= next;
+}
+
+// The stats thresholds and duplicate suppression, before any conversion.
+// False drops the frame. Dedup comes last, so that only frames passed on
+// become its reference.
+bool FFMPEGVideo::pass_frame_gates(const AVFrame *decoded_frame) {
+  if (stats_) {
+    has_last_stats_ = stats_->Compute(decoded_frame, last_stats_);
+    if (has_last_stats_ &&
+        (last_stats_.mean < options_.min_mean_luma ||
+         last_stats_.mean > options_.max_mean_luma ||
+         last_stats_.stddev < options_.min_contrast ||
+         last_stats_.laplacian_var < options_.min_laplacian_var)) {
+      stats_dropped_++;
+      return false;
+    }
+  }
+  return !dedup_ || dedup_->Accept(decoded_frame);
+}
+
+// Releases and counts the decoded frame when it is not sampled or a gate
+// drops it.
+bool FFMPEGVideo::drop_decoded_frame() {
+  if (sample_wanted(frame) && pass_frame_gates(frame)) {
+    return false;
+  }
+  av_frame_unref(frame);
+  frame_count_++;
+  return true;
+}
+
+// Moves on to the next frame inside options_.frame_ranges. False past the
+// last range.
+bool FFMPEGVideo::enter_frame_range() {
+  const std::vector<std::pair<int, int>> &ranges = options_.frame_ranges;
+  auto range = std::upper_bound(
+      ranges.begin(), ranges.end(), frame_count_,
+      [](int index, const std::pair<int, int> &entry) {
+        return index < entry.second;
+      });
+  if (range == ranges.end()) {
+    return false;
+  }
+  return frame_count_ >= range->first || SeekToFrame(range->first);
+}
+
+bool FFMPEGVideo::GetShardBounds(int n, std::vector<int> &bounds) {
+  std::vector<KeyframeEntry> keyframes;
+  if (n < 1 || !GetKeyframeIndex(keyframes)) {
+    return false;
+  }
+  // Every inner bound moves to the keyframe nearest its even split point.
+  bounds.assign(1, 0);
+  for (int k = 1; k < n; k++) {
+    int64_t target = static_cast<int64_t>(total_frames_) * k / n;
+    auto next = std::lower_bound(
+        keyframes.begin(), keyframes.end(), target,
+        [](const KeyframeEntry &entry, int64_t index) {
+          return entry.frame_index < index;
+        });
+    int bound = total_frames_;
+    if (next != keyframes.end()) {
+      bound = next->frame_index;
+    }
+    if (next != keyframes.begin() &&
+        (next == keyframes.end() ||
+         target - (next - 1)->frame_index < bound - target)) {
+      bound = (next - 1)->frame_index;
+    }
+    bounds.push_back(std::max(bound, bounds.back()));
+  }
+  bounds.push_back(total_frames_);
+  return true;
+}
+
+bool FFMPEGVideo::export_frames(std::vector<VideoFrame> &output_frames) {
+  output_frames.resize(filt_frames.size());
+  for (size_t i = 0; i < filt_frames.size(); i++) {
+    VideoFrame &output_frame = output_frames[i];
+    output_frame.av = make_frame_ref(filt_frames[i]);
+    if (!output_frame.av) {
+      std::cerr << "Failed to allocate AVFrame. Out of memory?" << std::endl;
+      return false;
+    }
+    output_frame.frame_id = frame_count_;
+    output_frame.pts = current_frame_pts_;
+    output_frame.time_seconds = current_frame_time_seconds_;
+  }
+  return true;
+}
+
+bool FFMPEGVideo::pull_next_frames() {
   if (!initialized) {
     std::cerr << "FFMPEGVideo not initialized. Cannot get frame." << std::endl;
     return false;
   }
 
-  int ret = 0;
-  bool frame_retrieved = false;
-  bool end_of_input_reached = false;
+  // Release the frames handed out by the previous call.
+  for (AVFrame *filt_frame : filt_frames) {
+    av_frame_unref(filt_frame);
+  }
+  if (!next_frame_allowed()) {
+    return false;
+  }
+
+  if (frame_converter_) {
+    if (decode_next_frame() < 0) {
+      return false;
+    }
+    while (drop_decoded_frame()) {
+      if (!next_frame_allowed() || decode_next_frame() < 0) {
+        return false;
+      }
+    }
+    bool converted = convert_frame(frame);
+    keep_decoded_frame();
+    if (!converted) {
+      return false;
+    }
+    process_retrieved_frame(filt_frames[0]);
+    return true;
+  }
 
-  while (!frame_retrieved) {
-    ret = av_buffersink_get_frame(buffersink_ctx, filt_frame);
+  while (!take_flushed_frames()) {
+    int ret = receive_filtered_frames();
     if (ret >= 0) {
-      return process_retrieved_frame(output_mat);
-    } else if (ret == AVERROR(EAGAIN)) {
-      // Filter graph needs more input. Proceed to decoding/reading.
-    } else if (ret == AVERROR_EOF) {
-      end_of_input_reached = true;
       break;
-    } else {
+    } else if (ret == AVERROR_EOF) {
+      return false;
+    } else if (ret != AVERROR(EAGAIN)) {
       check_error(ret, "Error receiving frame from filter graph");
       return false;
     }
 
-    if (!end_of_input_reached) {
-      ret = avcodec_receive_frame(dec_ctx, frame);
-      if (ret >= 0) {
-        frame->pts = frame->best_effort_timestamp;
-
-        int add_frame_ret = av_buffersrc_add_frame_flags(
-            buffersrc_ctx, frame, AV_BUFFERSRC_FLAG_KEEP_REF);
-        if (check_error(add_frame_ret, "Error feeding frame to filter graph")) {
-          av_frame_unref(frame);
-          return false;
-        }
-        av_frame_unref(frame);
-        continue;
-      } else if (ret == AVERROR(EAGAIN)) {
-        // Decoder needs more packets. Proceed to reading input.
-      } else if (ret == AVERROR_EOF) {
-        end_of_input_reached = true;
-        break;
-      } else {
-        check_error(ret, "Error receiving frame from decoder");
-        return false;
-      }
-
-      ret = av_read_frame(fmt_ctx, pkt);
-      if (ret < 0) {
-        if (ret == AVERROR_EOF) {
-          end_of_input_reached = true;
-          break;
-        } else {
-          check_error(ret, "Error reading packet from input");
-          return false;
-        }
-      }
-
-      if (pkt->stream_index == video_stream_idx) {
-        int send_packet_ret;
-        while ((send_packet_ret = avcodec_send_packet(dec_ctx, pkt)) ==
-               AVERROR(EAGAIN)) {
-          int drain_ret = avcodec_receive_frame(dec_ctx, frame);
-          if (drain_ret >= 0) {
-            int add_drain_frame_to_filter_ret = av_buffersrc_add_frame_flags(
-                buffersrc_ctx, frame, AV_BUFFERSRC_FLAG_KEEP_REF);
-            if (check_error(add_drain_frame_to_filter_ret,
-                            "Error feeding drained frame to filter graph")) {
-              av_frame_unref(frame);
-              av_packet_unref(pkt);
-              return false;
-            }
-            av_frame_unref(frame);
-
-            int pull_filtered_ret =
-                av_buffersink_get_frame(buffersink_ctx, filt_frame);
-            if (pull_filtered_ret >= 0) {
-              av_packet_unref(pkt);
-              return process_retrieved_frame(output_mat);
-            } else if (pull_filtered_ret != AVERROR(EAGAIN) &&
-                       pull_filtered_ret != AVERROR_EOF) {
-              check_error(pull_filtered_ret, "Error receiving filtered frame "
-                                             "during packet send retry drain");
-              av_packet_unref(pkt);
-              return false;
-            }
-          } else if (drain_ret == AVERROR(EAGAIN) || drain_ret == AVERROR_EOF) {
-            std::cerr << "Warning: Cannot drain decoder to send packet. "
-                         "Breaking send retry loop."
-                      << std::endl;
-            break;
-          } else {
-            check_error(
-                drain_ret,
-                "Error receiving frame from decoder during packet send retry");
-            av_packet_unref(pkt);
-            return false;
-          }
-        }
-
-        if (send_packet_ret < 0) {
-          check_error(send_packet_ret,
-                      "Error sending packet to decoder after retries");
-          av_packet_unref(pkt);
-          return false;
-        }
-      }
-      av_packet_unref(pkt);
-    }
-  } // End of main while(!frame_retrieved) loop
-
-  // --- Final Flushing Logic ---
-  if (end_of_input_reached) {
+    // Filter graph needs more input. Decode and feed another frame.
+    ret = decode_next_frame();
+    if (ret == AVERROR_EOF) {
 #if !NDEBUG
-    std::cout << "Initiating pipeline flushing..." << std::endl;
+      std::cout << "Initiating filter graph flushing..." << std::endl;
 #endif
-    avcodec_send_packet(dec_ctx, nullptr);
-    while (true) {
-      ret = avcodec_receive_frame(dec_ctx, frame);
-      if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-        break;
-      } else if (check_error(ret,
-                             "Error receiving flushed frame from decoder")) {
+      ret = av_buffersrc_add_frame_flags(buffersrc_ctx, nullptr, 0);
+      if (check_error(ret, "Error flushing buffer source")) {
         return false;
       }
-      frame->pts = frame->best_effort_timestamp;
-      int add_flush_frame_to_filter_ret = av_buffersrc_add_frame_flags(
-          buffersrc_ctx, frame, AV_BUFFERSRC_FLAG_KEEP_REF);
-      if (check_error(add_flush_frame_to_filter_ret,
-                      "Error feeding flushed frame to filter graph")) {
-        av_frame_unref(frame);
+      continue;
+    } else if (ret < 0) {
+      return false;
+    } else if (drop_decoded_frame()) {
+      if (!next_frame_allowed()) {
         return false;
       }
-      av_frame_unref(frame);
+      continue;
     }
 
-    int add_flush_to_buffersrc_ret =
-        av_buffersrc_add_frame_flags(buffersrc_ctx, nullptr, 0);
-    if (check_error(add_flush_to_buffersrc_ret,
-                    "Error flushing buffer source")) {
+    bool fed = feed_filter_graph(frame);
+    keep_decoded_frame();
+    if (!fed) {
       return false;
     }
+  }
 
-    while (true) {
-      ret = av_buffersink_get_frame(buffersink_ctx, filt_frame);
-      if (ret >= 0) {
-        return process_retrieved_frame(output_mat);
-      } else if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-        break;
-      } else {
-        check_error(ret, "Error receiving flushed frame from filter graph");
-        return false;
+  process_retrieved_frame(filt_frames[0]);
+  return true;
+}
+
+// Feeds a decoded frame to the graph. A frame from the other decoder kind
+// (after a hardware/software switch) first gets a graph built for it.
+bool FFMPEGVideo::feed_filter_graph(const AVFrame *decoded_frame) {
+  bool hw_frame = decoded_frame->hw_frames_ctx != nullptr;
+  if (hw_frame != filter_hw_input_ && !rebuild_filter_graph(decoded_frame)) {
+    initialized = false;
+    return false;
+  }
+
+  // KEEP_REF takes a new reference, the caller's frame is left untouched.
+  int64_t start_us = av_gettime_relative();
+  int ret = av_buffersrc_add_frame_flags(
+      buffersrc_ctx, const_cast<AVFrame *>(decoded_frame),
+      AV_BUFFERSRC_FLAG_KEEP_REF);
+  filter_busy_us_ += av_gettime_relative() - start_us;
+  filter_frames_++;
+  return !check_error(ret, "Error feeding frame to filter graph");
+}
+
+// Converts a decoded frame into filt_frames[0] without the filter graph.
+bool FFMPEGVideo::convert_frame(const AVFrame *decoded_frame) {
+  int64_t start_us = av_gettime_relative();
+  bool converted = frame_converter_->Convert(decoded_frame, filt_frames[0]);
+  filter_busy_us_ += av_gettime_relative() - start_us;
+  filter_frames_++;
+  return converted;
+}
+
+// Receives all outputs of one frame. Returns 0, AVERROR(EAGAIN) while the
+// graph needs more input, AVERROR_EOF, or an error code.
+int FFMPEGVideo::receive_filtered_frames() {
+  int64_t start_us = av_gettime_relative();
+  int ret = av_buffersink_get_frame(buffersink_ctxs[0], filt_frames[0]);
+  if (ret >= 0 && !pull_remaining_outputs()) {
+    ret = AVERROR(EINVAL);
+  }
+  filter_busy_us_ += av_gettime_relative() - start_us;
+  return ret;
+}
+
+// Flushes the current graph, keeping the frames it still held for the next
+// Get*/FilterFrame calls, and builds a new one for input_frame.
+bool FFMPEGVideo::rebuild_filter_graph(const AVFrame *input_frame) {
+  int ret = av_buffersrc_add_frame_flags(buffersrc_ctx, nullptr, 0);
+  if (!check_error(ret, "Error flushing buffer source")) {
+    while (av_buffersink_get_frame(buffersink_ctxs[0], filt_frames[0]) >= 0 &&
+           pull_remaining_outputs()) {
+      std::vector<std::shared_ptr<AVFrame>> outputs;
+      for (AVFrame *filt_frame : filt_frames) {
+        outputs.push_back(make_frame_ref(filt_frame));
       }
+      flushed_frames_.push_back(std::move(outputs));
+    }
+  }
+  for (AVFrame *filt_frame : filt_frames) {
+    av_frame_unref(filt_frame);
+  }
+
+  avfilter_graph_free(&filter_graph);
+  buffersrc_ctx = nullptr;
+  buffersink_ctxs.clear();
+  return init_filter_graph(input_frame);
+}
+
+// Moves the oldest frames left over from a replaced graph into filt_frames.
+bool FFMPEGVideo::take_flushed_frames() {
+  if (flushed_frames_.empty()) {
+    return false;
+  }
+  std::vector<std::shared_ptr<AVFrame>> outputs =
+      std::move(flushed_frames_.front());
+  flushed_frames_.pop_front();
+  for (size_t i = 0; i < filt_frames.size(); i++) {
+    if (!outputs[i]) {
+      std::cerr << "Failed to allocate AVFrame. Out of memory?" << std::endl;
+      return false;
+    }
+    av_frame_move_ref(filt_frames[i], outputs[i].get());
+  }
+  return true;
+}
+
+bool FFMPEGVideo::pull_remaining_outputs() {
+  // The first output produced a frame, the others must have one for the
+  // same decoded frame as well.
+  for (size_t i = 1; i < buffersink_ctxs.size(); i++) {
+    int ret = av_buffersink_get_frame(buffersink_ctxs[i], filt_frames[i]);
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+      std::cerr << "Filter output '" << output_names_[i]
+                << "' has no frame matching output '" << output_names_[0]
+                << "'. Every output must emit one frame per decoded frame."
+                << std::endl;
+      return false;
+    } else if (check_error(ret, "Error receiving frame from filter output '" +
+                                    output_names_[i] + "'")) {
+      return false;
     }
   }
-  return false;
+  return true;
 }
 
 // Getter implementations
@@ -252,6 +1245,81 @@ int64_t FFMPEGVideo::get_last_frame_pts() const { return current_frame_pts_; }
 double FFMPEGVideo::get_last_frame_time_seconds() const {
   return current_frame_time_seconds_;
 }
+AVRational FFMPEGVideo::get_time_base() const { return video_time_base_; }
+const std::string &FFMPEGVideo::get_filename() const {
+  return input_filename_;
+}
+const std::string &FFMPEGVideo::get_filter_descr() const {
+  return filter_descr_;
+}
+const FFMPEGVideoOptions &FFMPEGVideo::get_options() const { return options_; }
+int FFMPEGVideo::get_end_frame() const { return end_frame_; }
+
+double FFMPEGVideo::get_dedup_score() const {
+  return dedup_ ? dedup_->get_last_score() : -1.0;
+}
+
+uint64_t FFMPEGVideo::get_dedup_passed() const {
+  return dedup_ ? dedup_->get_passed() : 0;
+}
+
+uint64_t FFMPEGVideo::get_dedup_dropped() const {
+  return dedup_ ? dedup_->get_dropped() : 0;
+}
+
+uint64_t FFMPEGVideo::get_stats_dropped() const { return stats_dropped_; }
+bool FFMPEGVideo::isHardwareDecoding() const { return hw_decoding_; }
+std::string FFMPEGVideo::get_converter_name() const {
+  return frame_converter_ ? frame_converter_->get_name() : "avfilter";
+}
+std::string FFMPEGVideo::get_decoder_name() const {
+  return dec_ctx && dec_ctx->codec ? dec_ctx->codec->name : "";
+}
+double FFMPEGVideo::get_session_wait_ms() const { return session_wait_ms_; }
+double FFMPEGVideo::get_decode_latency_ms() const { return decode_latency_ms_; }
+int FFMPEGVideo::get_filter_threads() const {
+  return filter_graph ? filter_graph->nb_threads : 0;
+}
+double FFMPEGVideo::get_filter_time_ms() const {
+  // Gated, sampled out or skipped frames never reach the filter stage.
+  return filter_frames_ > 0 ? filter_busy_us_ / 1000.0 / filter_frames_
+                            : 0.0;
+}
+int FFMPEGVideo::get_decoder_threads() const {
+  return dec_ctx ? dec_ctx->thread_count : 0;
+}
+std::string FFMPEGVideo::get_decoder_thread_type() const {
+  if (!dec_ctx || hw_decoding_) {
+    return "";
+  }
+  // The decoder may support fewer threading types than requested.
+  switch (dec_ctx->active_thread_type) {
+  case FF_THREAD_FRAME:
+    return "frame";
+  case FF_THREAD_SLICE:
+    return "slice";
+  default:
+    return "none";
+  }
+}
+uint64_t FFMPEGVideo::get_hw_to_sw_switches() const {
+  return hw_to_sw_switches_;
+}
+uint64_t FFMPEGVideo::get_sw_to_hw_switches() const {
+  return sw_to_hw_switches_;
+}
+int FFMPEGVideo::get_output_count() const {
+  return static_cast<int>(output_names_.size());
+}
+bool FFMPEGVideo::get_letterbox(LetterboxTransform &transform) const {
+  return frame_converter_ && frame_converter_->get_letterbox(transform);
+}
+const TensorWriter &FFMPEGVideo::get_tensor_writer() const {
+  return tensor_writer_;
+}
+const std::vector<std::string> &FFMPEGVideo::get_output_names() const {
+  return output_names_;
+}
 
 // Callback function to select the hardware pixel format for the decoder
 // Note: 'static' is part of the declaration in the header for static member
@@ -298,10 +1366,64 @@ FFMPEGVideo::get_hw_format(AVCodecContext *ctx,
 bool FFMPEGVideo::init() {
   int ret = 0;
 
+  if (!tensor_writer_.Init(options_.tensor_layout,
+                           options_.tensor_channel_order,
+                           options_.tensor_dtype, options_.tensor_mean,
+                           options_.tensor_scale)) {
+    return false;
+  }
+
+  if (options_.dedup_threshold > 0.0) {
+    if (options_.dedup_thumb_width <= 0 || options_.dedup_thumb_height <= 0) {
+      std::cerr << "Invalid dedup thumbnail size." << std::endl;
+      return false;
+    }
+    dedup_.reset(new DuplicateFrameFilter(
+        options_.dedup_thumb_width, options_.dedup_thumb_height,
+        options_.dedup_threshold, options_.dedup_max_skip));
+  }
+
+  if (options_.compute_stats) {
+    if (options_.stats_width < 0 || options_.stats_height < 0 ||
+        options_.stats_bins < 1 || options_.stats_bins > 256) {
+      std::cerr << "Invalid stats size or bins (1-256)." << std::endl;
+      return false;
+    }
+    stats_.reset(new FrameStatsCalculator(
+        options_.stats_width, options_.stats_height, options_.stats_bins));
+  }
+
+  const std::vector<double> &sample_times = options_.sample_timestamps;
+  int sample_modes = (options_.sample_every_n > 1) +
+                     (options_.sample_target_fps > 0) + !sample_times.empty();
+  if (options_.sample_every_n < 0 || !(options_.sample_target_fps >= 0) ||
+      isinf(options_.sample_target_fps) || sample_modes > 1) {
+    std::cerr << "Invalid sampling: set one of sample_every_n (>= 0), "
+                 "sample_target_fps (> 0) or sample_timestamps."
+              << std::endl;
+    return false;
+  }
+  for (size_t i = 0; i < sample_times.size(); i++) {
+    if (!(sample_times[i] >= 0) || isinf(sample_times[i]) ||
+        (i > 0 && sample_times[i] < sample_times[i - 1])) {
+      std::cerr << "sample_timestamps must be sorted, finite and >= 0."
+                << std::endl;
+      return false;
+    }
+  }
+
   // --- 1. Open input file and find stream info ---
 #if !NDEBUG
   std::cout << "Opening input file: " << input_filename_ << std::endl;
 #endif
+  fmt_ctx = avformat_alloc_context();
+  if (!fmt_ctx) {
+    std::cerr << "Failed to allocate format context." << std::endl;
+    return false;
+  }
+  if (options_.nonblocking) {
+    fmt_ctx->flags |= AVFMT_FLAG_NONBLOCK;
+  }
   ret =
       avformat_open_input(&fmt_ctx, input_filename_.c_str(), nullptr, nullptr);
   if (check_error(ret, "Failed to open input file")) {
@@ -355,7 +1477,176 @@ bool FFMPEGVideo::init() {
               << std::endl;
   }
 
-  // --- 2. Initialize Hardware Acceleration ---
+  // Store video dimensions
+  video_width_ = fmt_ctx->streams[video_stream_idx]->codecpar->width;
+  video_height_ = fmt_ctx->streams[video_stream_idx]->codecpar->height;
+
+  // Plain resize/convert descriptions may bypass the filter graph.
+  if (!init_converter()) {
+    return false;
+  }
+  // Degrading rebuilds the graph mid-stream for software frames.
+  if (options_.degrade_latency_ms > 0.0 && !frame_converter_ &&
+      needs_hw_frames(options_.sw_filter_descr.empty()
+                          ? filter_descr_
+                          : options_.sw_filter_descr)) {
+    std::cerr << "degrade_latency_ms needs a sw_filter_descr for software "
+                 "frames, the filter description uses hardware ones."
+              << std::endl;
+    return false;
+  }
+
+  // --- 2. Setup Decoder (hardware unless unavailable) ---
+  if (!init_decoder()) {
+    return false;
+  }
+
+  // --- 3. Setup Filter Graph ---
+  if (frame_converter_) {
+    frame_converter_->get_output_size(video_width_, video_height_, frame_width_,
+                                    frame_height_);
+    return true;
+  }
+  return init_filter_graph();
+}
+
+// Picks a fast path when the output is a plain resize + pixel format
+// conversion: "auto" takes the luma plane for gray outputs, swscale else.
+bool FFMPEGVideo::init_converter() {
+  const std::string &converter = options_.converter;
+  bool letterbox =
+      options_.letterbox_width > 0 || options_.letterbox_height > 0;
+  if (converter == "avfilter" && letterbox) {
+    std::cerr << "Letterboxing needs a converter other than avfilter."
+              << std::endl;
+    return false;
+  } else if (converter == "avfilter") {
+    return true;
+  } else if (converter != "auto" && converter != "swscale" &&
+             converter != "simd" && converter != "luma") {
+    std::cerr << "Unknown converter '" << converter
+              << "' (avfilter, swscale, simd, luma or auto)." << std::endl;
+    return false;
+  }
+
+  int width = options_.out_width;
+  int height = options_.out_height;
+  AVPixelFormat format = AV_PIX_FMT_NONE;
+  bool plain = false;
+  if (!options_.out_format.empty()) {
+    format = av_get_pix_fmt(options_.out_format.c_str());
+    if (format == AV_PIX_FMT_NONE) {
+      std::cerr << "Unknown output format '" << options_.out_format << "'."
+                << std::endl;
+      return false;
+    }
+    plain = true;
+  } else {
+    plain = FrameConverter::ParseFilterDescr(filter_descr_, width, height,
+                                           format);
+  }
+
+  if (!plain || output_names_.size() != 1) {
+    if (converter != "auto" || letterbox) {
+      std::cerr << "The " << converter
+                << " converter needs a single output and either out_format "
+                   "or a plain \"scale=w=W:h=H,format=F\" description."
+                << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  if (options_.resize_filter != "area" &&
+      options_.resize_filter != "bilinear") {
+    std::cerr << "Unknown resize filter '" << options_.resize_filter
+              << "' (area or bilinear)." << std::endl;
+    return false;
+  }
+  bool bilinear = options_.resize_filter == "bilinear";
+
+  if (converter == "luma" ||
+      (converter == "auto" && format == AV_PIX_FMT_GRAY8)) {
+    if (format != AV_PIX_FMT_GRAY8) {
+      std::cerr << "The luma converter outputs gray only." << std::endl;
+      return false;
+    }
+    frame_converter_.reset(new LumaConverter(width, height, bilinear));
+  } else if (converter == "simd") {
+    if (format != AV_PIX_FMT_BGR24 && format != AV_PIX_FMT_RGB24) {
+      std::cerr << "The simd converter outputs bgr24 or rgb24 only."
+                << std::endl;
+      return false;
+    }
+    frame_converter_.reset(new YuvConverter(width, height, format, bilinear));
+  } else {
+    frame_converter_.reset(
+        new SwsConverter(width, height, format, options_.sws_threads));
+  }
+  if (letterbox &&
+      !frame_converter_->set_letterbox(options_.letterbox_width,
+                                       options_.letterbox_height,
+                                       options_.letterbox_pad)) {
+    return false;
+  }
+#if !NDEBUG
+  std::cout << "Using the " << frame_converter_->get_name()
+            << " converter instead of a filter graph." << std::endl;
+#endif
+  return true;
+}
+
+// Takes a decoder session from the governor and opens the hardware decoder,
+// or the software one when forced or allowed as a fallback.
+bool FFMPEGVideo::init_decoder() {
+  HwSessionGovernor &governor = HwSessionGovernor::instance();
+  bool use_hw = !options_.force_software;
+
+  if (use_hw || governor.governs_software()) {
+    int64_t wait_start_us = av_gettime_relative();
+    session_ticket_ = governor.Acquire(options_.session_priority,
+                                       options_.session_wait_ms);
+    session_wait_ms_ = (av_gettime_relative() - wait_start_us) / 1000.0;
+    if (!session_ticket_) {
+      if (!options_.sw_fallback) {
+        std::cerr << "Timed out after " << session_wait_ms_
+                  << "ms waiting for a decoder session." << std::endl;
+        return false;
+      }
+      std::cerr << "Warning: No decoder session available after "
+                << session_wait_ms_ << "ms, using software decoding."
+                << std::endl;
+      governor.record_fallback();
+      use_hw = false;
+    }
+  }
+
+  if (use_hw && !init_hw_decoder()) {
+    governor.record_hw_open_failure();
+    if (!options_.sw_fallback) {
+      return false;
+    }
+    std::cerr << "Warning: Hardware decoder failed to open, using software "
+                 "decoding."
+              << std::endl;
+    governor.record_fallback();
+    free_decoder();
+    session_ticket_.reset();
+    use_hw = false;
+  }
+
+  if (!use_hw && !init_sw_decoder()) {
+    return false;
+  }
+  hw_decoding_ = use_hw;
+  last_switch_us_ = av_gettime_relative();
+  return true;
+}
+
+bool FFMPEGVideo::init_hw_decoder() {
+  int ret = 0;
+
+  // --- Initialize Hardware Acceleration ---
   AVHWDeviceType hw_type = AV_HWDEVICE_TYPE_NONE;
   const char *hw_device_type_name = "rkmpp";
 
@@ -373,11 +1664,18 @@ bool FFMPEGVideo::init() {
             << av_hwdevice_get_type_name(hw_type) << std::endl;
 #endif
   AVDictionary *hw_device_opts = nullptr;
-  // Set 'afbc' as a device option for RKMPP.
-  int ret_dict_set = av_dict_set(&hw_device_opts, "afbc", "1", 0);
-  if (ret_dict_set < 0) {
-    std::cerr << "Failed to set 'afbc' option in device dictionary: "
-              << av_err2str(ret_dict_set) << std::endl;
+  // Set 'afbc' as a device option for RKMPP. Compressed (AFBC) frames can
+  // only be read by RGA, not downloaded for the CPU converters, the crops
+  // of the decoded frames (keep_decoded), duplicate suppression or stats.
+  bool cpu_reads_frames = frame_converter_ || options_.keep_decoded ||
+                          options_.dedup_threshold > 0 ||
+                          options_.compute_stats;
+  if (!cpu_reads_frames) {
+    int ret_dict_set = av_dict_set(&hw_device_opts, "afbc", "1", 0);
+    if (ret_dict_set < 0) {
+      std::cerr << "Failed to set 'afbc' option in device dictionary: "
+                << av_err2str(ret_dict_set) << std::endl;
+    }
   }
   ret = av_hwdevice_ctx_create(&hw_device_ctx, hw_type, nullptr, hw_device_opts,
                                0);
@@ -389,7 +1687,7 @@ bool FFMPEGVideo::init() {
   std::cout << "Successfully created HW device context: " << hw_device_type_name
             << std::endl;
 #endif
-  // --- 3. Setup Decoder Context ---
+  // --- Setup Decoder Context ---
   const AVCodec *decoder = avcodec_find_decoder_by_name("hevc_rkmpp");
   if (!decoder) {
     std::cerr << "HEVC rkmpp decoder not found. Ensure FFmpeg is built with "
@@ -412,10 +1710,6 @@ bool FFMPEGVideo::init() {
     return false;
   }
 
-  // Store video dimensions
-  video_width_ = dec_ctx->width;
-  video_height_ = dec_ctx->height;
-
   dec_ctx->hw_device_ctx = av_buffer_ref(hw_device_ctx);
   if (!dec_ctx->hw_device_ctx) {
     std::cerr << "Failed to set HW device context for codec context."
@@ -475,27 +1769,157 @@ bool FFMPEGVideo::init() {
   std::cout << "Assigned explicit hw_frames_ctx to decoder context."
             << std::endl;
 #endif
-  // --- 4. Setup Filter Graph ---
+  return true;
+}
+
+bool FFMPEGVideo::init_sw_decoder() {
+  int ret = 0;
+  const AVCodecParameters *codecpar =
+      fmt_ctx->streams[video_stream_idx]->codecpar;
+
+  const AVCodec *decoder = avcodec_find_decoder(codecpar->codec_id);
+  if (!decoder) {
+    std::cerr << "No software decoder found for codec "
+              << avcodec_get_name(codecpar->codec_id) << "." << std::endl;
+    return false;
+  }
+#if !NDEBUG
+  std::cout << "Using software decoder: " << decoder->name << std::endl;
+#endif
+  dec_ctx = avcodec_alloc_context3(decoder);
+  if (!dec_ctx) {
+    std::cerr << "Failed to allocate decoder context." << std::endl;
+    return false;
+  }
+
+  ret = avcodec_parameters_to_context(dec_ctx, codecpar);
+  if (check_error(ret, "Failed to copy codec parameters to decoder context")) {
+    return false;
+  }
+
+  if (!set_decoder_threads()) {
+    return false;
+  }
+  if (options_.export_side_data) {
+    dec_ctx->flags2 |= AV_CODEC_FLAG2_EXPORT_MVS;
+    dec_ctx->export_side_data |= AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS;
+  }
+
+  ret = avcodec_open2(dec_ctx, decoder, nullptr);
+  if (check_error(ret, "Failed to open software decoder")) {
+    return false;
+  }
+  active_sw_decoders++;
+  counts_as_sw_decoder_ = true;
+#if !NDEBUG
+  std::cout << "Software decoder opened with " << dec_ctx->thread_count
+            << " thread(s). Decoder output pix_fmt: "
+            << av_get_pix_fmt_name(dec_ctx->pix_fmt) << std::endl;
+#endif
+  return true;
+}
+
+// Sets thread_count/thread_type of the software decoder from the options.
+// "auto" splits the cores between the software decoders of the process and
+// caps the count by resolution, as small frames do not scale.
+bool FFMPEGVideo::set_decoder_threads() {
+  const std::string &type = options_.decoder_thread_type;
+  if (type == "frame") {
+    dec_ctx->thread_type = FF_THREAD_FRAME;
+  } else if (type == "slice") {
+    dec_ctx->thread_type = FF_THREAD_SLICE;
+  } else if (type == "frame+slice") {
+    dec_ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+  } else if (type == "auto") {
+    // Frame threading delays output by one frame per thread, which live
+    // inputs cannot afford.
+    dec_ctx->thread_type = options_.nonblocking
+                               ? FF_THREAD_SLICE
+                               : FF_THREAD_FRAME | FF_THREAD_SLICE;
+  } else {
+    std::cerr << "Unknown decoder thread type '" << type
+              << "' (frame, slice, frame+slice or auto)." << std::endl;
+    return false;
+  }
+
+  if (options_.decoder_threads >= 0) {
+    dec_ctx->thread_count = options_.decoder_threads; // 0 = libavcodec auto
+    return true;
+  }
+
+  int cores = std::max<int>(std::thread::hardware_concurrency(), 1);
+  int readers = active_sw_decoders + 1;
+  int64_t pixels = static_cast<int64_t>(dec_ctx->width) * dec_ctx->height;
+  int max_threads = pixels <= 640 * 480     ? 2
+                    : pixels <= 1920 * 1080 ? 8
+                                            : 16;
+  dec_ctx->thread_count = std::min(std::max(cores / readers, 1), max_threads);
+  return true;
+}
+
+void FFMPEGVideo::free_decoder() {
+  if (counts_as_sw_decoder_) {
+    active_sw_decoders--;
+    counts_as_sw_decoder_ = false;
+  }
+  avcodec_free_context(&dec_ctx);
+  av_buffer_unref(&hw_frames_ctx);
+  av_buffer_unref(&hw_device_ctx);
+}
+
+bool FFMPEGVideo::init_filter_graph(const AVFrame *input_frame) {
+  int ret = 0;
+
+  // The graph input follows the decoder, or the given frame on a rebuild.
+  int width = dec_ctx->width;
+  int height = dec_ctx->height;
+  AVPixelFormat pix_fmt = dec_ctx->pix_fmt;
+  AVRational sample_aspect_ratio = dec_ctx->sample_aspect_ratio;
+  AVColorSpace color_space = dec_ctx->colorspace;
+  AVColorRange color_range = dec_ctx->color_range;
+  AVBufferRef *input_frames_ctx = hw_frames_ctx;
+  if (input_frame) {
+    width = input_frame->width;
+    height = input_frame->height;
+    pix_fmt = static_cast<AVPixelFormat>(input_frame->format);
+    sample_aspect_ratio = input_frame->sample_aspect_ratio;
+    color_space = input_frame->colorspace;
+    color_range = input_frame->color_range;
+    input_frames_ctx = input_frame->hw_frames_ctx;
+  }
+  filter_hw_input_ = input_frames_ctx != nullptr;
+
   filter_graph = avfilter_graph_alloc();
   if (!filter_graph) {
     std::cerr << "Failed to allocate filter graph." << std::endl;
     return false;
   }
 
+  // Threading must be set before any filter is added.
+  if (options_.filter_thread_type == "none") {
+    filter_graph->thread_type = 0;
+  } else if (options_.filter_thread_type == "slice") {
+    filter_graph->thread_type = AVFILTER_THREAD_SLICE;
+  } else {
+    std::cerr << "Unknown filter thread type '" << options_.filter_thread_type
+              << "' (slice or none)." << std::endl;
+    return false;
+  }
+  filter_graph->nb_threads = std::max(options_.filter_threads, 0);
+  if (options_.sws_threads != 1) {
+    // Slice threading inside swscale, for the scale/format filters.
+    std::string sws_opts = "threads=" + std::to_string(options_.sws_threads);
+    filter_graph->scale_sws_opts = av_strdup(sws_opts.c_str());
+  }
+
   AVRational time_base = fmt_ctx->streams[video_stream_idx]->time_base;
   std::string buffersrc_args =
-      "video_size=" + std::to_string(dec_ctx->width) + "x" +
-      std::to_string(dec_ctx->height) +
-      ":pix_fmt=" + av_get_pix_fmt_name(dec_ctx->pix_fmt) +
+      "video_size=" + std::to_string(width) + "x" + std::to_string(height) +
+      ":pix_fmt=" + av_get_pix_fmt_name(pix_fmt) +
       ":time_base=" + std::to_string(time_base.num) + "/" +
       std::to_string(time_base.den) +
-      ":pixel_aspect=" + std::to_string(dec_ctx->sample_aspect_ratio.num) +
-      "/" + std::to_string(dec_ctx->sample_aspect_ratio.den);
-
-  // Use the member variable filter_descr_ here
-  // std::string filter_descr =
-  // "scale_rkrga=w=1280:h=720:format=bgr24,hwmap=mode=read,format=bgr24"; //
-  // Old hardcoded
+      ":pixel_aspect=" + std::to_string(sample_aspect_ratio.num) + "/" +
+      std::to_string(sample_aspect_ratio.den);
 
   const AVFilter *buffersrc = avfilter_get_by_name("buffer");
   const AVFilter *buffersink = avfilter_get_by_name("buffersink");
@@ -513,18 +1937,21 @@ bool FFMPEGVideo::init() {
     return false;
   }
 
-  buffersrc_params->hw_frames_ctx = av_buffer_ref(hw_frames_ctx);
-  if (!buffersrc_params->hw_frames_ctx) {
-    std::cerr << "Failed to ref manually allocated hw_frames_ctx for "
-                 "buffersrc_params."
-              << std::endl;
-    av_free(buffersrc_params);
-    return false;
+  // Software decoded frames have no hardware frames context.
+  if (input_frames_ctx) {
+    buffersrc_params->hw_frames_ctx = av_buffer_ref(input_frames_ctx);
+    if (!buffersrc_params->hw_frames_ctx) {
+      std::cerr << "Failed to ref manually allocated hw_frames_ctx for "
+                   "buffersrc_params."
+                << std::endl;
+      av_free(buffersrc_params);
+      return false;
+    }
   }
 
   // Set colorspace and color_range directly from decoder context
-  buffersrc_params->color_space = dec_ctx->colorspace;
-  buffersrc_params->color_range = dec_ctx->color_range;
+  buffersrc_params->color_space = color_space;
+  buffersrc_params->color_range = color_range;
 
   ret = av_buffersrc_parameters_set(buffersrc_ctx, buffersrc_params);
   if (check_error(ret, "Failed to set parameters on buffersrc")) {
@@ -533,26 +1960,30 @@ bool FFMPEGVideo::init() {
   }
   av_free(buffersrc_params);
 
-  ret = avfilter_graph_create_filter(&buffersink_ctx, buffersink, "out",
-                                     nullptr, nullptr, filter_graph);
-  if (check_error(ret, "Cannot create buffer sink")) {
-    return false;
-  }
+  // One buffersink per requested output, named after its graph label.
+  for (const std::string &output_name : output_names_) {
+    AVFilterContext *sink_ctx = nullptr;
+    ret = avfilter_graph_create_filter(&sink_ctx, buffersink,
+                                       output_name.c_str(), nullptr, nullptr,
+                                       filter_graph);
+    if (check_error(ret, "Cannot create buffer sink '" + output_name + "'")) {
+      return false;
+    }
 
-  enum AVPixelFormat pix_fmts[] = {AV_PIX_FMT_NONE};
-  ret = av_opt_set_int_list(buffersink_ctx, "pix_fmts", pix_fmts,
-                            AV_PIX_FMT_NONE, AV_OPT_SEARCH_CHILDREN);
-  if (check_error(ret, "Cannot set output pixel format")) {
-    return false;
+    enum AVPixelFormat pix_fmts[] = {AV_PIX_FMT_NONE};
+    ret = av_opt_set_int_list(sink_ctx, "pix_fmts", pix_fmts, AV_PIX_FMT_NONE,
+                              AV_OPT_SEARCH_CHILDREN);
+    if (check_error(ret, "Cannot set output pixel format")) {
+      return false;
+    }
+    buffersink_ctxs.push_back(sink_ctx);
   }
 
   AVFilterInOut *outputs = avfilter_inout_alloc();
-  AVFilterInOut *inputs = avfilter_inout_alloc();
+  AVFilterInOut *inputs = nullptr;
 
-  if (!outputs || !inputs) {
+  if (!outputs) {
     std::cerr << "Failed to allocate AVFilterInOut structs." << std::endl;
-    avfilter_inout_free(&outputs);
-    avfilter_inout_free(&inputs);
     return false;
   }
 
@@ -561,19 +1992,47 @@ bool FFMPEGVideo::init() {
   outputs->pad_idx = 0;
   outputs->next = nullptr;
 
-  inputs->name = av_strdup("out");
-  inputs->filter_ctx = buffersink_ctx;
-  inputs->pad_idx = 0;
-  inputs->next = nullptr;
+  // Chain the sinks, keeping the output_names_ order.
+  for (size_t i = buffersink_ctxs.size(); i-- > 0;) {
+    AVFilterInOut *sink_inout = avfilter_inout_alloc();
+    if (!sink_inout) {
+      std::cerr << "Failed to allocate AVFilterInOut structs." << std::endl;
+      avfilter_inout_free(&outputs);
+      avfilter_inout_free(&inputs);
+      return false;
+    }
+    sink_inout->name = av_strdup(output_names_[i].c_str());
+    sink_inout->filter_ctx = buffersink_ctxs[i];
+    sink_inout->pad_idx = 0;
+    sink_inout->next = inputs;
+    inputs = sink_inout;
+  }
 
-  // Use the member variable filter_descr_ here
-  ret = avfilter_graph_parse_ptr(filter_graph, filter_descr_.c_str(), &inputs,
+  // Software decoding may need a CPU-only description (no hwmap, ...).
+  const std::string &filter_descr =
+      (!filter_hw_input_ && !options_.sw_filter_descr.empty())
+          ? options_.sw_filter_descr
+          : filter_descr_;
+  ret = avfilter_graph_parse_ptr(filter_graph, filter_descr.c_str(), &inputs,
                                  &outputs, nullptr);
   if (check_error(ret, "Cannot parse filter graph")) {
     avfilter_inout_free(&outputs);
     avfilter_inout_free(&inputs);
     return false;
   }
+
+  // Whatever is left unlinked was not referenced by the description.
+  bool unlinked = false;
+  for (AVFilterInOut *cur = inputs; cur; cur = cur->next) {
+    std::cerr << "Filter output '" << cur->name
+              << "' not found in filter description." << std::endl;
+    unlinked = true;
+  }
+  avfilter_inout_free(&outputs);
+  avfilter_inout_free(&inputs);
+  if (unlinked) {
+    return false;
+  }
 #if !NDEBUG
   std::cout << "Configuring filter graph..." << std::endl;
 #endif
@@ -582,8 +2041,8 @@ bool FFMPEGVideo::init() {
     return false;
   }
 
-  frame_width_ = buffersink_ctx->inputs[0]->w;
-  frame_height_ = buffersink_ctx->inputs[0]->h;
+  frame_width_ = buffersink_ctxs[0]->inputs[0]->w;
+  frame_height_ = buffersink_ctxs[0]->inputs[0]->h;
 
   return true;
 }
@@ -593,13 +2052,19 @@ void FFMPEGVideo::cleanup() {
   std::cout << "Cleaning up FFmpeg resources..." << std::endl;
 #endif
   avfilter_graph_free(&filter_graph);
-  avcodec_free_context(&dec_ctx);
+  frame_converter_.reset();
+  free_decoder();
+  session_ticket_.reset();
   avformat_close_input(&fmt_ctx);
   av_packet_free(&pkt);
   av_frame_free(&frame);
-  av_frame_free(&filt_frame);
-  av_buffer_unref(&hw_frames_ctx);
-  av_buffer_unref(&hw_device_ctx);
+  for (AVFrame *&filt_frame : filt_frames) {
+    av_frame_free(&filt_frame);
+  }
+  last_decoded_.reset();
+  frame_ring_.reset();
+  crop_converter_.reset();
+  av_frame_free(&crop_frame_);
 #if !NDEBUG
   std::cout << "FFmpeg resources cleaned up." << std::endl;
 #endif
@@ -7,8 +7,11 @@
 #include <unistd.h>
 
 #include <chrono>
+#include <deque>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -23,19 +26,278 @@ extern "C" {
 #include <libavutil/hwcontext.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/mem.h>
+#include <libavutil/motion_vector.h>
 #include <libavutil/opt.h>
+#include <libavutil/time.h>
 }
 
 // OpenCV headers
 #include <opencv2/opencv.hpp>
 
+#include "frame_dedup.h"
+#include "frame_ring.h"
+#include "frame_stats.h"
+#include "session_governor.h"
+#include "sws_converter.h"
+#include "tensor_writer.h"
+#include "yuv_converter.h"
+
+// Optional reader configuration. The defaults reproduce the behaviour of the
+// two-argument constructor.
+struct FFMPEGVideoOptions {
+  // Labels of the filter graph outputs to expose, one buffersink each, e.g.
+  // "split=2[a][b];[a]scale_rkrga=...[det];[b]scale_rkrga=...[motion]" with
+  // {"det", "motion"}. Empty means a single unlabeled output ("out").
+  std::vector<std::string> output_names;
+  // Open the input with AVFMT_FLAG_NONBLOCK, so reads return instead of
+  // waiting for data (see isWaitingForInput()).
+  bool nonblocking = false;
+
+  // Decoder selection and session governance (see HwSessionGovernor).
+  bool force_software = false;  // Always use the software decoder
+  bool sw_fallback = false;     // Use it when no HW session can be had
+  int session_priority = 0;     // Higher opens first (Priority policy)
+  int session_wait_ms = -1;     // Max wait for a session, -1 waits forever
+  std::string sw_filter_descr;  // Filter for software decoded frames
+                                // (empty reuses the main description)
+
+  // Automatic degradation: when the average hardware decode latency per
+  // frame exceeds degrade_latency_ms, the stream moves to the software
+  // decoder at the next keyframe, and retries the hardware one after
+  // recover_after_ms. 0 disables it. Hardware-only filter descriptions
+  // (hwmap, scale_rkrga, ...) need a sw_filter_descr for it.
+  double degrade_latency_ms = 0.0;
+  int recover_after_ms = 10000;
+
+  // Software decoder threading. -1 threads picks a count from the
+  // resolution, the cores and the software decoders already open; 0 leaves
+  // it to libavcodec. Thread type is "frame", "slice", "frame+slice" or
+  // "auto" (slice only for non-blocking, i.e. live, inputs).
+  int decoder_threads = -1;
+  std::string decoder_thread_type = "auto";
+
+  // Filter graph threading: threads for slice threaded filters (0 picks the
+  // core count), thread type "slice" or "none", and swscale slice threads
+  // used by the scale/format filters and the swscale converter (1 disables,
+  // 0 picks automatically).
+  int filter_threads = 0;
+  std::string filter_thread_type = "slice";
+  int sws_threads = 1;
+
+  // Conversion stage: "avfilter" always builds the filter graph, "swscale"
+  // resizes/converts with one cached SwsContext instead, and "auto" uses
+  // swscale when the description is a plain "scale=w=W:h=H,format=F" chain.
+  // "simd" converts NV12/YUV420P to bgr24/rgb24 with the built-in SIMD
+  // kernels and resizes in the same pass ("area" or "bilinear" sampling).
+  // "luma" (also picked by "auto" for gray outputs) hands out the Y plane of
+  // YUV frames without a copy, or downscaled with the same sampling.
+  // out_width/out_height/out_format describe the converter output directly
+  // (overriding the description, 0 keeps the source size).
+  std::string converter = "auto";
+  int out_width = 0;
+  int out_height = 0;
+  std::string out_format;
+  std::string resize_filter = "area";
+  // Letterbox: scale keeping the aspect ratio into a fixed canvas (instead
+  // of out_width/out_height) padded with letterbox_pad bytes, for detector
+  // inputs. Needs one of the converters above and a packed out_format.
+  int letterbox_width = 0; // 0 disables
+  int letterbox_height = 0;
+  int letterbox_pad = 114;
+
+  // Keep a reference to the decoded frame behind the last output, for
+  // GetCrops(). With a buffering filter graph it is the last frame fed.
+  // Hardware decoders then output uncompressed (non-AFBC) frames.
+  bool keep_decoded = false;
+
+  // Publish the first output of every frame into a POSIX shared memory ring
+  // of this name (empty disables) for FrameRingReader processes. Slots hold
+  // shm_ring_slot_size bytes, at least the first frame (0 sizes them by it);
+  // larger frames are skipped, with one error.
+  std::string shm_ring_name;
+  int shm_ring_slots = 8;
+  int64_t shm_ring_slot_size = 0;
+
+  // Duplicate suppression: a decoded frame whose dedup_thumb_width x
+  // dedup_thumb_height luma thumbnail differs from the one of the last frame
+  // passed on by at most dedup_threshold (mean absolute difference, 0-255)
+  // is dropped before filtering and conversion. 0 disables it;
+  // dedup_max_skip > 0 passes a frame after that many drops in a row.
+  // Hardware decoders then output plain frames, mapped for the thumbnail.
+  double dedup_threshold = 0.0;
+  int dedup_max_skip = 0;
+  int dedup_thumb_width = 64;
+  int dedup_thumb_height = 36;
+
+  // Luma statistics of every decoded frame (GetLastFrameStats()): mean,
+  // deviation (contrast), a stats_bins histogram and the Laplacian variance
+  // (blur), over the luma plane scaled to stats_width x stats_height (0
+  // keeps the source size). Frames outside the thresholds below are dropped
+  // before filtering and conversion (and before duplicate suppression); the
+  // defaults pass everything. Hardware decoders then output plain frames.
+  bool compute_stats = false;
+  int stats_width = 0;
+  int stats_height = 0;
+  int stats_bins = 16;
+  double min_mean_luma = 0.0;
+  double max_mean_luma = 255.0;
+  double min_contrast = 0.0; // Standard deviation
+  double min_laplacian_var = 0.0;
+
+  // Compressed-domain info of every decoded frame (GetFrameInfo()): picture
+  // type, keyframe flag and packet size, plus motion vectors and QP from
+  // the software decoder (hardware decoders do not export them).
+  bool export_side_data = false;
+
+  // Decode only these [start, end) frame ranges (display order, sorted),
+  // e.g. the active ranges of ScanActivity(): frames between them are
+  // skipped by seeking when a keyframe lies in between, else decoded without
+  // filtering. Seekable inputs only; empty reads everything.
+  std::vector<std::pair<int, int>> frame_ranges;
+
+  // Frame sampling, one of: hand out every sample_every_n-th frame (display
+  // order), the first frame at or after each 1 / sample_target_fps step of
+  // the timestamps, or the first frame at or after each of the sorted
+  // sample_timestamps (seconds, >= 0). On seekable inputs the frames in between
+  // are skipped like those between frame_ranges, with the decoder
+  // discarding non-reference frames far from the next sample; other inputs
+  // decode everything and drop unsampled frames before filtering.
+  int sample_every_n = 0; // 0 or 1 samples every frame
+  double sample_target_fps = 0.0;
+  std::vector<double> sample_timestamps;
+
+  // Tensor output (get_next_tensor/get_next_batch): layout "chw" or "hwc",
+  // channel order "rgb" or "bgr", dtype "float32", "float16" or "uint8",
+  // each element being (x - mean) * scale, with one value for all channels
+  // or one per channel.
+  std::string tensor_layout = "chw";
+  std::string tensor_channel_order = "rgb";
+  std::string tensor_dtype = "float32";
+  std::vector<float> tensor_mean = {0.0f};
+  std::vector<float> tensor_scale = {1.0f};
+};
+
+// Reference-counted filtered frame. The pixel data stays valid for as long as
+// any copy of it is alive, so it can be shared between consumers without
+// copying.
+struct VideoFrame {
+  std::shared_ptr<AVFrame> av;
+  int frame_id = 0;
+  int64_t pts = AV_NOPTS_VALUE;
+  double time_seconds = 0.0;
+};
+
+// Crop box in source frame pixels, x2/y2 exclusive.
+struct CropBox {
+  int x1 = 0;
+  int y1 = 0;
+  int x2 = 0;
+  int y2 = 0;
+};
+
+// Compressed-domain info of a decoded frame (export_side_data option).
+struct CompressedFrameInfo {
+  int64_t pts = AV_NOPTS_VALUE;
+  char pict_type = '?'; // 'I', 'P', 'B', ...
+  bool key_frame = false;
+  int packet_size = -1; // -1 if unknown
+  float qp_mean = -1.0f; // Over the block area, -1 without QP data
+  int qp_min = -1;
+  int qp_max = -1;
+  float motion = -1.0f; // MotionScore(), -1 without motion vectors
+  std::vector<AVMotionVector> motion_vectors;
+};
+
+// Keyframe of the video stream, found by a demux-only scan.
+struct KeyframeEntry {
+  int frame_index; // Display order index of the keyframe
+  int64_t pts;     // In the stream time base
+  int64_t pos;     // Byte position, -1 if unknown
+};
+
 class FFMPEGVideo {
 public:
   FFMPEGVideo(const std::string &filename, const std::string &filter_descr_str);
+  FFMPEGVideo(const std::string &filename, const std::string &filter_descr_str,
+              const FFMPEGVideoOptions &options);
   ~FFMPEGVideo();
 
   bool isInitialized() const;
+  // True when the last decode call stopped because a non-blocking input had
+  // no data yet, rather than at the end of the input or on an error.
+  bool isWaitingForInput() const;
+  // Returns the first output of the next decoded frame. The Mat references
+  // the filtered frame and stays valid until the next Get* call.
   bool GetNextFrame(cv::Mat &output_mat);
+  // Returns every output (in output_names order) of the next decoded frame,
+  // so the decode is paid once for all of them.
+  bool GetNextFrames(std::vector<cv::Mat> &output_mats);
+  // Same as above, but hands out references that outlive the next call.
+  bool GetNextFrame(VideoFrame &output_frame);
+  bool GetNextFrames(std::vector<VideoFrame> &output_frames);
+  // Hands the outputs of the last GetNextFrames() call back, the next
+  // GetNextFrame*() call returns them again (e.g. a frame that did not fit
+  // a batch).
+  void UngetFrames(const std::vector<VideoFrame> &frames);
+
+  // Two-stage access for callers that decide per decoded frame whether the
+  // filter and conversion stage is worth running. Decoding and filtering may
+  // run on different threads, but do not mix these with GetNextFrame*().
+  bool DecodeFrame(std::shared_ptr<AVFrame> &decoded_frame);
+  // Runs one decoded frame through the filter graph; concurrent callers are
+  // serialized. Returns 0 with the outputs, AVERROR(EAGAIN) when there is
+  // no output yet (the graph holds the frame, or a gate dropped it), or a
+  // negative error code.
+  int FilterFrame(const AVFrame *decoded_frame,
+                  std::vector<VideoFrame> &output_frames);
+
+  // The decoded frame kept by the keep_decoded option. Its pts/time refer to
+  // the decoded frame.
+  bool GetDecodedFrame(VideoFrame &decoded_frame) const;
+  // Crops the boxes out of a decoded NV12/YUV420P (or hardware) frame and
+  // resizes each to width x height bgr24/rgb24, written back to back to dst
+  // (boxes.size() x height x width x 3 bytes). Hardware frames are
+  // downloaded once, there is no full-frame RGB conversion.
+  bool GetCrops(const AVFrame *decoded_frame,
+                const std::vector<CropBox> &boxes, int width, int height,
+                AVPixelFormat format, uint8_t *dst);
+
+  // Compressed-domain info of a frame from DecodeFrame(), without any
+  // conversion, or of the decoded frame behind the last output (needs the
+  // export_side_data option).
+  bool GetFrameInfo(const AVFrame *decoded_frame,
+                    CompressedFrameInfo &info) const;
+  bool GetLastFrameInfo(CompressedFrameInfo &info) const;
+  // Luma statistics of the last decoded frame, passed on or not (needs the
+  // compute_stats option).
+  bool GetLastFrameStats(FrameStats &stats) const;
+
+  // Keyframes of the input (seekable files only), scanned once without
+  // decoding; also makes get_frame_total() exact.
+  bool GetKeyframeIndex(std::vector<KeyframeEntry> &keyframes);
+  // The sorted timestamps of all frames, from the same scan.
+  bool GetFrameTimestamps(std::vector<int64_t> &timestamps);
+  // Takes the index scanned by another reader of the same file, so that it
+  // is not scanned again.
+  void SetKeyframeIndex(const std::vector<KeyframeEntry> &keyframes,
+                        const std::vector<int64_t> &timestamps);
+  // Seeks so that the next frame returned is frame_index (display order):
+  // jumps to the keyframe before it and decodes (unconverted) up to it.
+  bool SeekToFrame(int frame_index);
+  // Limits reading to [start, end) frames (end -1 for the whole stream),
+  // seeking to start.
+  bool SetFrameRange(int start, int end);
+  // Boundaries of n shards of about equal length starting at keyframes:
+  // shard k is [bounds[k], bounds[k + 1]).
+  bool GetShardBounds(int n, std::vector<int> &bounds);
+
+  // Wraps an 8-bit gray or packed 3 channel frame into a Mat (no copy).
+  static bool FrameToMat(const AVFrame *src, cv::Mat &output_mat);
+  // Wraps the planes of an NV12/NV21 (Y, UV) or I420 (Y, U, V) frame into
+  // Mats (no copy): Y is H x W CV_8UC1, interleaved chroma is
+  // ceil(H/2) x ceil(W/2) CV_8UC2, planar chroma ceil(H/2) x ceil(W/2)
+  // CV_8UC1. Returns false for other formats.
+  static bool FrameToPlanes(const AVFrame *src, std::vector<cv::Mat> &planes);
 
   // Getter methods
   int get_video_width() const;
@@ -46,23 +308,99 @@ public:
   int get_frame_total() const;
   int64_t get_last_frame_pts() const;
   double get_last_frame_time_seconds() const;
+  AVRational get_time_base() const;
+  bool isHardwareDecoding() const;
+  std::string get_converter_name() const;
+  std::string get_decoder_name() const;
+  double get_session_wait_ms() const;
+  double get_decode_latency_ms() const; // Average decoder time per frame
+  int get_filter_threads() const;
+  double get_filter_time_ms() const; // Average filter stage time per frame
+  int get_decoder_threads() const;
+  std::string get_decoder_thread_type() const; // Active type, software only
+  uint64_t get_hw_to_sw_switches() const;
+  uint64_t get_sw_to_hw_switches() const;
+  int get_output_count() const;
+  // Placement of the last frame in the letterbox canvas. False when not
+  // letterboxing.
+  bool get_letterbox(LetterboxTransform &transform) const;
+  const TensorWriter &get_tensor_writer() const; // Set up from the options
+  const std::vector<std::string> &get_output_names() const;
+  const std::string &get_filename() const;
+  const std::string &get_filter_descr() const;
+  const FFMPEGVideoOptions &get_options() const;
+  int get_end_frame() const; // -1 without a frame range
+  // Duplicate suppression: difference of the last compared frame (-1 if
+  // none or disabled), frames passed on and dropped.
+  double get_dedup_score() const;
+  uint64_t get_dedup_passed() const;
+  uint64_t get_dedup_dropped() const;
+  uint64_t get_stats_dropped() const; // Frames failing the stats thresholds
 
 private:
   std::string input_filename_;
   std::string filter_descr_;
+  FFMPEGVideoOptions options_;
+  std::vector<std::string> output_names_;
 
   AVFormatContext *fmt_ctx;
   AVCodecContext *dec_ctx;
   AVFilterGraph *filter_graph;
   AVFilterContext *buffersrc_ctx;
-  AVFilterContext *buffersink_ctx;
+  std::vector<AVFilterContext *> buffersink_ctxs; // One per output name
   AVBufferRef *hw_device_ctx;
   AVBufferRef *hw_frames_ctx;
   AVPacket *pkt;
   AVFrame *frame;
-  AVFrame *filt_frame;
+  std::vector<AVFrame *> filt_frames; // One per output name
+  std::vector<VideoFrame> unget_frames_; // Still in filt_frames as well
   int video_stream_idx;
   bool initialized;
+  bool pkt_pending_; // pkt was refused with EAGAIN and must be resent
+  bool input_would_block_;
+  bool hw_decoding_;
+  std::unique_ptr<SessionTicket> session_ticket_; // Null if not governed
+  double session_wait_ms_;
+  bool filter_hw_input_; // Graph built for hardware (vs software) frames
+  // Outputs left in a graph replaced after a decoder switch
+  std::deque<std::vector<std::shared_ptr<AVFrame>>> flushed_frames_;
+
+  // Hardware/software switching state
+  bool switch_requested_; // Switch at the next keyframe
+  bool switch_draining_;  // Keyframe held in pkt, draining the old decoder
+  int64_t decode_busy_us_;
+  double decode_latency_ms_;
+  int frames_since_switch_;
+  int64_t last_switch_us_;
+  uint64_t hw_to_sw_switches_;
+  uint64_t sw_to_hw_switches_;
+  bool counts_as_sw_decoder_; // Included in the process-wide decoder count
+  int64_t filter_busy_us_;    // Time spent feeding/pulling the filter graph
+  int64_t filter_frames_;     // Frames fed to the filter graph or converter
+  std::mutex filter_mutex_;   // Serializes FilterFrame()
+  std::unique_ptr<FrameConverter> frame_converter_; // Replaces the filter graph
+  TensorWriter tensor_writer_;
+  std::unique_ptr<DuplicateFrameFilter> dedup_; // dedup_threshold only
+  std::unique_ptr<FrameStatsCalculator> stats_; // compute_stats only
+  FrameStats last_stats_;
+  bool has_last_stats_;
+  uint64_t stats_dropped_;
+  std::shared_ptr<AVFrame> last_decoded_; // keep_decoded only
+  std::unique_ptr<YuvConverter> crop_converter_;
+  AVFrame *crop_frame_; // Download target for crops of hardware frames
+  std::unique_ptr<FrameRingWriter> frame_ring_; // shm_ring_name only
+  // export_side_data only: (timestamp, size) of recent packets, and the info
+  // of the decoded frame behind the last output
+  std::deque<std::pair<int64_t, int>> packet_sizes_;
+  CompressedFrameInfo last_info_;
+  bool has_last_info_;
+  std::vector<KeyframeEntry> keyframes_; // Empty until GetKeyframeIndex()
+  std::vector<int64_t> frame_pts_; // Sorted timestamps of all frames, likewise
+  int64_t seek_min_pts_; // Frames before it are dropped after a seek
+  int end_frame_;        // SetFrameRange() end, -1 for none
+  int sample_seekable_;  // Sampling by frame index, -1 until the first read
+  double sample_prev_time_; // Last decoded frame, when sampling by timestamps
+  bool has_sample_prev_;
 
   int frame_count_;
   int total_frames_;
@@ -76,13 +414,53 @@ private:
   double current_frame_time_seconds_;
 
   // Private helper function to handle a successfully retrieved filtered frame.
-  bool process_retrieved_frame(cv::Mat &output_mat_ref);
+  void process_retrieved_frame(const AVFrame *src);
+  void publish_frame(const AVFrame *src);
+  // Fills filt_frames with the outputs of the next decoded frame.
+  bool pull_next_frames();
+  // Pulls outputs 1..N once output 0 produced a frame.
+  bool pull_remaining_outputs();
+  // Moves filt_frames into reference-counted VideoFrames.
+  bool export_frames(std::vector<VideoFrame> &output_frames);
+  // Pulls the next decoded frame into 'frame'. Returns 0 on success,
+  // AVERROR_EOF once the decoder is drained, or a negative error code.
+  int decode_next_frame();
+  void reset_pipeline();
+  void reset_filter_graph();
+  bool seek_to_frame(int frame_index, bool reset_graph);
+  bool enter_frame_range();
+  bool next_frame_allowed();
+  bool sampling() const;
+  bool sample_by_index();
+  double next_sample_time(double previous) const;
+  int next_sample_index() const;
+  bool sample_wanted(const AVFrame *decoded_frame);
+  int frame_index_of(int64_t pts) const;
+  bool skip_to_frame(int frame_index);
+  bool pass_frame_gates(const AVFrame *decoded_frame);
+  bool drop_decoded_frame();
+  int receive_next_frame(int64_t &start_us, int64_t &read_us);
+  void update_decode_latency();
+  bool switch_decoder();
+  bool feed_filter_graph(const AVFrame *decoded_frame);
+  int receive_filtered_frames();
+  bool convert_frame(const AVFrame *decoded_frame);
+  void keep_decoded_frame();
+  bool rebuild_filter_graph(const AVFrame *input_frame);
+  bool take_flushed_frames();
 
   // Callback for hardware format negotiation (static member function)
   static enum AVPixelFormat get_hw_format(AVCodecContext *ctx,
                                           const enum AVPixelFormat *pix_fmts);
   // Initialization and cleanup methods
   bool init();
+  bool init_converter();
+  bool init_decoder();
+  bool init_hw_decoder();
+  bool init_sw_decoder();
+  bool set_decoder_threads();
+  void free_decoder();
+  bool init_filter_graph(const AVFrame *input_frame = nullptr);
   void cleanup();
 };
 
@@ -0,0 +1,203 @@
+#include "frame_broadcaster.h"
+
+#include <algorithm>
+#include <chrono>
+
+// FrameSubscription Class Implementation
+FrameSubscription::FrameSubscription(size_t capacity, DropPolicy policy,
+                                     int output_idx)
+    : capacity_(std::max<size_t>(capacity, 1)), policy_(policy),
+      output_idx_(output_idx), closed_(false), finished_(false),
+      delivered_(0), dropped_(0) {}
+
+bool FrameSubscription::Pop(VideoFrame &output_frame, int timeout_ms) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto ready = [this] { return !queue_.empty() || closed_ || finished_; };
+  if (timeout_ms < 0) {
+    not_empty_.wait(lock, ready);
+  } else if (!not_empty_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                                  ready)) {
+    return false; // Timed out
+  }
+  if (closed_ || queue_.empty()) {
+    return false;
+  }
+  output_frame = std::move(queue_.front());
+  queue_.pop_front();
+  delivered_++;
+  not_full_.notify_one();
+  return true;
+}
+
+void FrameSubscription::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  closed_ = true;
+  queue_.clear();
+  not_empty_.notify_all();
+  not_full_.notify_all();
+}
+
+bool FrameSubscription::push(const VideoFrame &input_frame,
+                             const std::atomic<bool> &stopping) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (closed_) {
+    return false;
+  }
+
+  switch (policy_) {
+  case DropPolicy::Block:
+    not_full_.wait(lock, [&] {
+      return queue_.size() < capacity_ || closed_ || stopping.load();
+    });
+    if (closed_ || stopping.load()) {
+      return !closed_;
+    }
+    break;
+  case DropPolicy::DropOldest:
+    while (queue_.size() >= capacity_) {
+      queue_.pop_front();
+      dropped_++;
+    }
+    break;
+  case DropPolicy::LatestOnly:
+    dropped_ += queue_.size();
+    queue_.clear();
+    break;
+  }
+
+  // Only the reference is copied, the frame data is shared.
+  queue_.push_back(input_frame);
+  not_empty_.notify_one();
+  return true;
+}
+
+void FrameSubscription::finish() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  finished_ = true;
+  not_empty_.notify_all();
+  not_full_.notify_all();
+}
+
+bool FrameSubscription::isClosed() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return closed_;
+}
+size_t FrameSubscription::get_capacity() const { return capacity_; }
+DropPolicy FrameSubscription::get_policy() const { return policy_; }
+int FrameSubscription::get_output_index() const { return output_idx_; }
+size_t FrameSubscription::get_queued() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_.size();
+}
+uint64_t FrameSubscription::get_delivered() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return delivered_;
+}
+uint64_t FrameSubscription::get_dropped() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_;
+}
+
+// FrameBroadcaster Class Implementation
+FrameBroadcaster::FrameBroadcaster(const std::string &filename,
+                                   const std::string &filter_descr_str,
+                                   const FFMPEGVideoOptions &options)
+    : video_(filename, filter_descr_str, options), stopping_(false),
+      running_(false), frame_count_(0), stream_ended_(false) {}
+
+FrameBroadcaster::~FrameBroadcaster() { Stop(); }
+
+bool FrameBroadcaster::isInitialized() const { return video_.isInitialized(); }
+
+std::shared_ptr<FrameSubscription>
+FrameBroadcaster::Subscribe(size_t capacity, DropPolicy policy,
+                            const std::string &output_name) {
+  int output_idx = 0;
+  if (!output_name.empty()) {
+    const std::vector<std::string> &names = video_.get_output_names();
+    auto it = std::find(names.begin(), names.end(), output_name);
+    if (it == names.end()) {
+      std::cerr << "Unknown filter output '" << output_name
+                << "' requested by subscriber." << std::endl;
+      return nullptr;
+    }
+    output_idx = static_cast<int>(it - names.begin());
+  }
+
+  auto subscription =
+      std::make_shared<FrameSubscription>(capacity, policy, output_idx);
+  std::lock_guard<std::mutex> lock(subscribers_mutex_);
+  if (stream_ended_) {
+    subscription->finish(); // Stream already ended
+  }
+  subscribers_.push_back(subscription);
+  return subscription;
+}
+
+void FrameBroadcaster::Start() {
+  if (thread_.joinable()) {
+    return;
+  }
+  if (!video_.isInitialized()) {
+    std::cerr << "FFMPEGVideo not initialized. Cannot start broadcaster."
+              << std::endl;
+    return;
+  }
+  stopping_ = false;
+  running_ = true;
+  {
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
+    stream_ended_ = false;
+  }
+  thread_ = std::thread(&FrameBroadcaster::run, this);
+}
+
+void FrameBroadcaster::Stop() {
+  stopping_ = true;
+  {
+    // Wake up the broadcaster if it is blocked on a full subscription.
+    std::lock_guard<std::mutex> lock(subscribers_mutex_);
+    for (auto &subscription : subscribers_) {
+      std::lock_guard<std::mutex> sub_lock(subscription->mutex_);
+      subscription->not_full_.notify_all();
+    }
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+bool FrameBroadcaster::isRunning() const { return running_; }
+uint64_t FrameBroadcaster::get_frame_count() const { return frame_count_; }
+const FFMPEGVideo &FrameBroadcaster::get_video() const { return video_; }
+
+void FrameBroadcaster::run() {
+  std::vector<VideoFrame> frames;
+  std::vector<std::shared_ptr<FrameSubscription>> subscribers;
+
+  while (!stopping_ && video_.GetNextFrames(frames)) {
+    frame_count_++;
+    {
+      std::lock_guard<std::mutex> lock(subscribers_mutex_);
+      subscribers_.erase(
+          std::remove_if(subscribers_.begin(), subscribers_.end(),
+                         [](const std::shared_ptr<FrameSubscription> &s) {
+                           return s->isClosed();
+                         }),
+          subscribers_.end());
+      subscribers = subscribers_;
+    }
+    // A slow subscriber only drops its own frames, unless it asked to block.
+    for (auto &subscription : subscribers) {
+      subscription->push(frames[subscription->get_output_index()], stopping_);
+    }
+    frames.clear();
+  }
+
+  std::lock_guard<std::mutex> lock(subscribers_mutex_);
+  running_ = false;
+  stream_ended_ = true;
+  for (auto &subscription : subscribers_) {
+    subscription->finish();
+  }
+}
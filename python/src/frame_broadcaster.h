@@ -0,0 +1,104 @@
+#ifndef FRAME_BROADCASTER_H
+#define FRAME_BROADCASTER_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ffmpeg_video.h"
+
+// What a subscription does when its queue is full and a new frame arrives.
+enum class DropPolicy {
+  Block,      // Wait for the consumer (stalls the broadcaster)
+  DropOldest, // Discard the oldest queued frame
+  LatestOnly  // Keep only the newest frame, regardless of capacity
+};
+
+// Bounded per-consumer queue of shared (not copied) frames.
+class FrameSubscription {
+public:
+  FrameSubscription(size_t capacity, DropPolicy policy, int output_idx);
+
+  // Waits up to timeout_ms (-1 waits forever) for the next frame. Returns
+  // false on timeout, or once the stream ended and the queue is drained.
+  bool Pop(VideoFrame &output_frame, int timeout_ms = -1);
+  // Unsubscribes; queued frames are released and Pop() returns false.
+  void Close();
+
+  // Getter methods
+  bool isClosed() const;
+  size_t get_capacity() const;
+  DropPolicy get_policy() const;
+  int get_output_index() const;
+  size_t get_queued() const;
+  uint64_t get_delivered() const;
+  uint64_t get_dropped() const;
+
+private:
+  friend class FrameBroadcaster;
+
+  // Called by the broadcaster thread. Returns false once closed.
+  bool push(const VideoFrame &input_frame, const std::atomic<bool> &stopping);
+  // Marks the end of the stream, waking up blocked consumers.
+  void finish();
+
+  const size_t capacity_;
+  const DropPolicy policy_;
+  const int output_idx_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::deque<VideoFrame> queue_;
+  bool closed_;
+  bool finished_;
+  uint64_t delivered_;
+  uint64_t dropped_;
+};
+
+// Runs one decode/filter pipeline on a background thread and fans every
+// filtered frame out to any number of subscriptions by reference.
+class FrameBroadcaster {
+public:
+  FrameBroadcaster(const std::string &filename,
+                   const std::string &filter_descr_str,
+                   const FFMPEGVideoOptions &options = FFMPEGVideoOptions());
+  ~FrameBroadcaster();
+
+  bool isInitialized() const;
+  // output_name selects one of the reader outputs (empty for the first).
+  std::shared_ptr<FrameSubscription>
+  Subscribe(size_t capacity, DropPolicy policy,
+            const std::string &output_name = "");
+  void Start();
+  void Stop();
+
+  // Getter methods
+  bool isRunning() const;
+  uint64_t get_frame_count() const;
+  const FFMPEGVideo &get_video() const;
+
+private:
+  FFMPEGVideo video_;
+
+  std::thread thread_;
+  std::atomic<bool> stopping_;
+  std::atomic<bool> running_;
+  std::atomic<uint64_t> frame_count_;
+
+  std::mutex subscribers_mutex_;
+  std::vector<std::shared_ptr<FrameSubscription>> subscribers_;
+  bool stream_ended_; // The thread ran and exited (subscribers_mutex_)
+
+  // Broadcaster thread body
+  void run();
+};
+
+#endif // FRAME_BROADCASTER_H
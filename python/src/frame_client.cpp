@@ -0,0 +1,164 @@
+#include "frame_client.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <iostream>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
+#include "frame_server_protocol.h"
+
+// Owns the connection; frames keep it open to send their release.
+struct FrameClientSocket {
+  explicit FrameClientSocket(int socket_fd) : fd(socket_fd) {}
+  ~FrameClientSocket() { close(fd); }
+  int fd;
+};
+
+// ServerFrame Class Implementation
+ServerFrame::ServerFrame()
+    : av(av_frame_alloc()), seq(0), frame_id(0), pts(0), time_seconds(0.0),
+      map_(MAP_FAILED), map_size_(0) {}
+
+ServerFrame::~ServerFrame() {
+  av_frame_free(&av);
+  if (map_ != MAP_FAILED) {
+    munmap(map_, map_size_);
+  }
+  if (socket_) {
+    FrameServerRelease release = {kFrameServerMagic, 0, seq};
+    SendFrameServerMessage(socket_->fd, &release, sizeof(release), -1,
+                           MSG_DONTWAIT);
+  }
+}
+
+// FrameClient Class Implementation
+FrameClient::FrameClient() : ended_(false) {}
+
+FrameClient::~FrameClient() { Close(); }
+
+bool FrameClient::Connect(const std::string &socket_path,
+                          const std::string &stream, int max_inflight) {
+  Close();
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path) ||
+      stream.size() >= kFrameServerStreamNameSize || max_inflight < 1) {
+    std::cerr << "Frame server socket path or stream name too long, or "
+                 "max_inflight below 1."
+              << std::endl;
+    return false;
+  }
+  memcpy(addr.sun_path, socket_path.c_str(), socket_path.size());
+
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (fd < 0 ||
+      connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr))) {
+    std::cerr << "Failed to connect to frame server " << socket_path << ": "
+              << strerror(errno) << std::endl;
+    if (fd >= 0) {
+      close(fd);
+    }
+    return false;
+  }
+  std::shared_ptr<FrameClientSocket> connection(new FrameClientSocket(fd));
+
+  FrameServerSubscribe subscribe;
+  memset(&subscribe, 0, sizeof(subscribe));
+  subscribe.magic = kFrameServerMagic;
+  subscribe.version = kFrameServerVersion;
+  subscribe.max_inflight = static_cast<uint32_t>(max_inflight);
+  memcpy(subscribe.stream, stream.c_str(), stream.size());
+  FrameServerMessage reply;
+  int reply_fd;
+  if (!SendFrameServerMessage(fd, &subscribe, sizeof(subscribe), -1, 0) ||
+      !ReceiveFrameServerMessage(fd, &reply, sizeof(reply), reply_fd) ||
+      reply.magic != kFrameServerMagic) {
+    std::cerr << "Frame server handshake failed." << std::endl;
+    return false;
+  } else if (reply.type != kFrameServerAccepted) {
+    std::cerr << "Frame server rejected stream '" << stream << "'."
+              << std::endl;
+    return false;
+  }
+  socket_ = connection;
+  ended_ = false;
+  return true;
+}
+
+bool FrameClient::Read(std::shared_ptr<ServerFrame> &frame, int timeout_ms) {
+  if (!socket_ || ended_) {
+    return false;
+  }
+  struct pollfd pfd = {socket_->fd, POLLIN, 0};
+  int ret;
+  do {
+    ret = poll(&pfd, 1, timeout_ms);
+  } while (ret < 0 && errno == EINTR);
+  if (ret <= 0) {
+    return false;
+  }
+
+  FrameServerMessage message;
+  int fd;
+  if (!ReceiveFrameServerMessage(socket_->fd, &message, sizeof(message),
+                                 fd) ||
+      message.magic != kFrameServerMagic ||
+      message.type != kFrameServerFrame) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    ended_ = true; // End of stream, or the server went away
+    return false;
+  }
+
+  std::shared_ptr<ServerFrame> server_frame(new ServerFrame());
+  server_frame->seq = message.seq;
+  server_frame->socket_ = socket_; // Release from here on
+  if (fd >= 0 && message.size > 0) {
+    server_frame->map_ =
+        mmap(nullptr, message.size, PROT_READ, MAP_SHARED, fd, 0);
+    server_frame->map_size_ = message.size;
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+  AVFrame *av = server_frame->av;
+  if (!av || server_frame->map_ == MAP_FAILED) {
+    std::cerr << "Failed to map frame " << message.seq << "." << std::endl;
+    return false;
+  }
+  av->format = message.format;
+  av->width = message.width;
+  av->height = message.height;
+  av->pts = message.pts;
+  int size = av_image_fill_arrays(
+      av->data, av->linesize, static_cast<uint8_t *>(server_frame->map_),
+      static_cast<AVPixelFormat>(message.format), message.width,
+      message.height, 1);
+  if (size < 0 || static_cast<uint64_t>(size) > message.size) {
+    std::cerr << "Malformed frame " << message.seq << "." << std::endl;
+    return false;
+  }
+  server_frame->frame_id = message.frame_id;
+  server_frame->pts = message.pts;
+  server_frame->time_seconds = message.time_seconds;
+  frame = server_frame;
+  return true;
+}
+
+void FrameClient::Close() { socket_.reset(); }
+
+// Getter implementations
+bool FrameClient::isConnected() const { return socket_ != nullptr; }
+
+bool FrameClient::isEnded() const { return ended_; }
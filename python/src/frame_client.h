@@ -0,0 +1,61 @@
+#ifndef FRAME_CLIENT_H
+#define FRAME_CLIENT_H
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+struct FrameClientSocket;
+
+// A frame received from the frame server, mapped read only. av points into
+// the mapping (format, size, data, linesize; no buffer references). The
+// destructor unmaps it and releases the frame on the server.
+struct ServerFrame {
+  ServerFrame();
+  ~ServerFrame();
+
+  AVFrame *av;
+  uint64_t seq;
+  int frame_id;
+  int64_t pts;
+  double time_seconds;
+
+private:
+  friend class FrameClient;
+  std::shared_ptr<FrameClientSocket> socket_;
+  void *map_;
+  size_t map_size_;
+};
+
+// Client of the local frame server (cpp/frame-server.cpp): subscribes to a
+// stream over its Unix socket and receives every frame as a memfd, so many
+// processes share one decode without copying pixels.
+class FrameClient {
+public:
+  FrameClient();
+  ~FrameClient();
+
+  // max_inflight caps the frames held at once; the server drops frames
+  // while the client holds that many.
+  bool Connect(const std::string &socket_path, const std::string &stream,
+               int max_inflight = 4);
+  // Waits up to timeout_ms (-1 waits forever) for the next frame. Returns
+  // false on timeout, at the end of the stream (isEnded()) or on errors.
+  bool Read(std::shared_ptr<ServerFrame> &frame, int timeout_ms = -1);
+  void Close();
+
+  // Getter methods
+  bool isConnected() const;
+  bool isEnded() const;
+
+private:
+  std::shared_ptr<FrameClientSocket> socket_; // Shared with the frames
+  bool ended_;
+};
+
+#endif // FRAME_CLIENT_H
@@ -0,0 +1,318 @@
+#include "frame_converter.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+extern "C" {
+#include <libavutil/error.h>
+#include <libavutil/hwcontext.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include "av_error.h"
+
+// Row alignment of the output buffers
+static const int kOutputAlign = 32;
+
+static std::vector<std::string> split(const std::string &str, char sep) {
+  std::vector<std::string> parts;
+  size_t start = 0;
+  while (true) {
+    size_t end = str.find(sep, start);
+    parts.push_back(str.substr(start, end - start));
+    if (end == std::string::npos) {
+      return parts;
+    }
+    start = end + 1;
+  }
+}
+
+static bool parse_int(const std::string &str, int &value) {
+  char *end = nullptr;
+  long parsed = strtol(str.c_str(), &end, 10);
+  if (str.empty() || *end != '\0') {
+    return false;
+  }
+  value = static_cast<int>(parsed);
+  return true;
+}
+
+// Keeps the aspect ratio, rounded to a multiple of n (scale=-n semantics).
+static int keep_aspect(int64_t num, int64_t den, int n) {
+  long value = std::lround(static_cast<double>(num) / den / n);
+  return static_cast<int>(std::max(value, 1L)) * n;
+}
+
+// FrameConverter Class Implementation
+FrameConverter::FrameConverter(int width, int height, AVPixelFormat format)
+    : format_(format), out_width_(0), out_height_(0), width_(width),
+      height_(height), pool_(nullptr), sw_frame_(av_frame_alloc()),
+      map_hw_frames_(false), canvas_width_(0), canvas_height_(0), pad_value_(0),
+      content_view_(av_frame_alloc()), src_width_(0), src_height_(0),
+      src_format_(AV_PIX_FMT_NONE), src_colorspace_(0), src_range_(0),
+      configured_(false) {}
+
+FrameConverter::~FrameConverter() {
+  // Buffers still referenced keep the pool alive until released.
+  av_buffer_pool_uninit(&pool_);
+  av_frame_free(&sw_frame_);
+  av_frame_free(&content_view_);
+}
+
+void FrameConverter::set_map_hw_frames(bool map) { map_hw_frames_ = map; }
+
+bool FrameConverter::set_letterbox(int width, int height, int pad_value) {
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format_);
+  if (!desc || desc->log2_chroma_w || desc->log2_chroma_h ||
+      (desc->flags & (AV_PIX_FMT_FLAG_PLANAR | AV_PIX_FMT_FLAG_PAL |
+                      AV_PIX_FMT_FLAG_HWACCEL))) {
+    std::cerr << "Letterboxing needs a packed output format (e.g. bgr24)."
+              << std::endl;
+    return false;
+  }
+  if (width <= 0 || height <= 0 || pad_value < 0 || pad_value > 255) {
+    std::cerr << "Invalid letterbox " << width << "x" << height << " pad "
+              << pad_value << "." << std::endl;
+    return false;
+  }
+  canvas_width_ = width;
+  canvas_height_ = height;
+  pad_value_ = pad_value;
+  return true;
+}
+
+bool FrameConverter::ParseFilterDescr(const std::string &descr, int &width,
+                                      int &height, AVPixelFormat &format) {
+  width = 0;
+  height = 0;
+  format = AV_PIX_FMT_NONE;
+  bool scaled = false;
+
+  for (const std::string &filter : split(descr, ',')) {
+    size_t eq = filter.find('=');
+    std::string name = filter.substr(0, eq);
+    std::string args = eq == std::string::npos ? "" : filter.substr(eq + 1);
+
+    if (name == "scale" && !scaled && format == AV_PIX_FMT_NONE) {
+      std::vector<std::string> items = split(args, ':');
+      for (size_t i = 0; i < items.size(); i++) {
+        // Named (w=1280) or positional (1280:720) size arguments
+        std::string key = i == 0 ? "w" : i == 1 ? "h" : "";
+        std::string value = items[i];
+        size_t item_eq = items[i].find('=');
+        if (item_eq != std::string::npos) {
+          key = items[i].substr(0, item_eq);
+          value = items[i].substr(item_eq + 1);
+        }
+        bool parsed =
+            ((key == "w" || key == "width") && parse_int(value, width)) ||
+            ((key == "h" || key == "height") && parse_int(value, height));
+        if (!parsed) {
+          return false; // Expressions, flags, ... need the real filter
+        }
+      }
+      scaled = true;
+    } else if (name == "format" && format == AV_PIX_FMT_NONE) {
+      if (args.compare(0, 9, "pix_fmts=") == 0) {
+        args = args.substr(9);
+      }
+      format = av_get_pix_fmt(args.c_str()); // Fails on "a|b" lists
+      if (format == AV_PIX_FMT_NONE) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  return format != AV_PIX_FMT_NONE;
+}
+
+bool FrameConverter::Convert(const AVFrame *src, AVFrame *dst) {
+  const AVFrame *input = src;
+  if (src->hw_frames_ctx) {
+    av_frame_unref(sw_frame_);
+    int ret = AVERROR(ENOSYS);
+    if (map_hw_frames_) {
+      const AVHWFramesContext *frames_ctx =
+          reinterpret_cast<const AVHWFramesContext *>(
+              src->hw_frames_ctx->data);
+      sw_frame_->format = frames_ctx->sw_format;
+      ret = av_hwframe_map(sw_frame_, src, AV_HWFRAME_MAP_READ);
+      if (ret < 0) {
+        av_frame_unref(sw_frame_);
+        map_hw_frames_ = false; // Not supported, download from now on
+      }
+    }
+    if (ret < 0) {
+      ret = av_hwframe_transfer_data(sw_frame_, src, 0);
+      if (check_error(ret, "Failed to download hardware frame")) {
+        return false;
+      }
+    }
+    sw_frame_->colorspace = src->colorspace;
+    sw_frame_->color_range = src->color_range;
+    input = sw_frame_;
+  }
+
+  if (!configured_ || input->width != src_width_ ||
+      input->height != src_height_ || input->format != src_format_ ||
+      input->colorspace != src_colorspace_ ||
+      input->color_range != src_range_) {
+    src_width_ = input->width;
+    src_height_ = input->height;
+    src_format_ = input->format;
+    src_colorspace_ = input->colorspace;
+    src_range_ = input->color_range;
+
+    int out_width, out_height;
+    if (letterboxed()) {
+      // Largest aspect preserving size that fits, centered.
+      double scale =
+          std::min(static_cast<double>(canvas_width_) / src_width_,
+                   static_cast<double>(canvas_height_) / src_height_);
+      out_width = std::min(
+          std::max(static_cast<int>(std::lround(src_width_ * scale)), 1),
+          canvas_width_);
+      out_height = std::min(
+          std::max(static_cast<int>(std::lround(src_height_ * scale)), 1),
+          canvas_height_);
+      letterbox_.scale = scale;
+      letterbox_.pad_x = (canvas_width_ - out_width) / 2;
+      letterbox_.pad_y = (canvas_height_ - out_height) / 2;
+      letterbox_.width = out_width;
+      letterbox_.height = out_height;
+    } else {
+      get_output_size(input->width, input->height, out_width, out_height);
+    }
+    if (out_width != out_width_ || out_height != out_height_) {
+      av_buffer_pool_uninit(&pool_); // Reallocated on the next alloc_output
+      out_width_ = out_width;
+      out_height_ = out_height;
+    }
+    configured_ = configure(input);
+    if (!configured_) {
+      return false;
+    }
+  }
+
+  bool converted = convert(input, dst);
+  av_frame_unref(content_view_);
+  av_frame_unref(sw_frame_); // Unmaps the source, dst keeps what it shares
+  if (!converted) {
+    av_frame_unref(dst);
+    return false;
+  }
+  dst->pts = src->pts;
+  dst->sample_aspect_ratio = src->sample_aspect_ratio;
+  return true;
+}
+
+bool FrameConverter::alloc_output(const AVFrame *src, AVFrame *dst) {
+  int width = letterboxed() ? canvas_width_ : out_width_;
+  int height = letterboxed() ? canvas_height_ : out_height_;
+  if (!pool_) {
+    int size = av_image_get_buffer_size(format_, width, height, kOutputAlign);
+    if (check_error(size, "Invalid output size")) {
+      return false;
+    }
+    pool_ = av_buffer_pool_init(size, nullptr);
+    if (!pool_) {
+      std::cerr << "Failed to allocate buffer pool." << std::endl;
+      return false;
+    }
+  }
+
+  dst->buf[0] = av_buffer_pool_get(pool_);
+  if (!dst->buf[0]) {
+    std::cerr << "Failed to allocate output buffer. Out of memory?"
+              << std::endl;
+    return false;
+  }
+  av_image_fill_arrays(dst->data, dst->linesize, dst->buf[0]->data, format_,
+                       width, height, kOutputAlign);
+  dst->format = format_;
+  dst->width = width;
+  dst->height = height;
+
+  if (letterboxed()) {
+    // Pad bytes around the content, which convert() fills in.
+    int step = av_pix_fmt_desc_get(format_)->comp[0].step;
+    int left = letterbox_.pad_x * step;
+    int right = (canvas_width_ - letterbox_.pad_x - out_width_) * step;
+    for (int y = 0; y < canvas_height_; y++) {
+      uint8_t *row = dst->data[0] + static_cast<ptrdiff_t>(y) *
+                                        dst->linesize[0];
+      if (y < letterbox_.pad_y || y >= letterbox_.pad_y + out_height_) {
+        memset(row, pad_value_, static_cast<size_t>(canvas_width_) * step);
+      } else {
+        memset(row, pad_value_, left);
+        memset(row + left + out_width_ * step, pad_value_, right);
+      }
+    }
+  }
+  return true;
+}
+
+AVFrame *FrameConverter::content_frame(AVFrame *dst) {
+  if (!letterboxed()) {
+    return dst;
+  }
+  // Released by Convert() once convert() returns.
+  av_frame_unref(content_view_);
+  content_view_->buf[0] = av_buffer_ref(dst->buf[0]);
+  if (!content_view_->buf[0]) {
+    std::cerr << "Failed to reference output buffer. Out of memory?"
+              << std::endl;
+    return nullptr;
+  }
+  int step = av_pix_fmt_desc_get(format_)->comp[0].step;
+  content_view_->data[0] = dst->data[0] +
+                           static_cast<ptrdiff_t>(letterbox_.pad_y) *
+                               dst->linesize[0] +
+                           letterbox_.pad_x * step;
+  content_view_->linesize[0] = dst->linesize[0];
+  content_view_->format = format_;
+  content_view_->width = out_width_;
+  content_view_->height = out_height_;
+  return content_view_;
+}
+
+bool FrameConverter::letterboxed() const { return canvas_width_ > 0; }
+
+// Getter implementations
+void FrameConverter::get_output_size(int src_width, int src_height,
+                                     int &width, int &height) const {
+  if (letterboxed()) {
+    width = canvas_width_;
+    height = canvas_height_;
+    return;
+  }
+  width = width_ == 0 ? src_width : width_;
+  height = height_ == 0 ? src_height : height_;
+  if (width < 0 && height < 0) {
+    width = src_width;
+    height = src_height;
+  } else if (width < 0) {
+    width = keep_aspect(static_cast<int64_t>(height) * src_width, src_height,
+                        -width_);
+  } else if (height < 0) {
+    height = keep_aspect(static_cast<int64_t>(width) * src_height, src_width,
+                         -height_);
+  }
+}
+
+AVPixelFormat FrameConverter::get_format() const { return format_; }
+
+bool FrameConverter::get_letterbox(LetterboxTransform &transform) const {
+  if (!letterboxed() || letterbox_.width == 0) {
+    return false;
+  }
+  transform = letterbox_;
+  return true;
+}
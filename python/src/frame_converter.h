@@ -0,0 +1,101 @@
+#ifndef FRAME_CONVERTER_H
+#define FRAME_CONVERTER_H
+
+#include <string>
+
+extern "C" {
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+}
+
+// Maps letterboxed output coordinates back to the source frame:
+// x_src = (x - pad_x) / scale, y_src = (y - pad_y) / scale.
+struct LetterboxTransform {
+  double scale = 1.0;
+  int pad_x = 0;
+  int pad_y = 0;
+  int width = 0; // Size of the scaled image inside the canvas
+  int height = 0;
+};
+
+// Converts decoded frames to the output format without a filter graph, for
+// outputs that are a plain resize + pixel format conversion. The base class
+// downloads hardware frames, tracks source changes and hands out pooled
+// output buffers; subclasses do the actual conversion.
+class FrameConverter {
+public:
+  virtual ~FrameConverter();
+  FrameConverter(const FrameConverter &) = delete;
+  FrameConverter &operator=(const FrameConverter &) = delete;
+
+  // Converts src into dst (unreferenced).
+  bool Convert(const AVFrame *src, AVFrame *dst);
+
+  // Scales into a fixed width x height canvas keeping the aspect ratio, the
+  // rest is filled with pad_value bytes. Packed formats only.
+  bool set_letterbox(int width, int height, int pad_value);
+
+  // Maps hardware frames into memory instead of downloading them, where the
+  // device allows it (DRM PRIME): no copy, only the pixels the conversion
+  // reads are touched. Falls back to downloading.
+  void set_map_hw_frames(bool map);
+
+  // Accepts "[scale=w=W:h=H,]format=F" (also "scale=W:H" and
+  // "format=pix_fmts=F"). Returns false for anything else.
+  static bool ParseFilterDescr(const std::string &descr, int &width,
+                               int &height, AVPixelFormat &format);
+
+  // Getter methods
+  virtual const char *get_name() const = 0;
+  void get_output_size(int src_width, int src_height, int &width,
+                       int &height) const;
+  AVPixelFormat get_format() const;
+  // False until the first frame, or when not letterboxing.
+  bool get_letterbox(LetterboxTransform &transform) const;
+
+protected:
+  // Sizes follow the scale filter: 0 keeps the source size, a negative
+  // value keeps the aspect ratio, rounded to a multiple of -value.
+  FrameConverter(int width, int height, AVPixelFormat format);
+
+  // Called before the first frame and whenever the source size, format or
+  // colors change. out_width_/out_height_ are already updated.
+  virtual bool configure(const AVFrame *src) = 0;
+  // Writes the converted src into dst.
+  virtual bool convert(const AVFrame *src, AVFrame *dst) = 0;
+  // Gives dst a pooled buffer in format_, padded when letterboxing.
+  bool alloc_output(const AVFrame *src, AVFrame *dst);
+  // The out_width_ x out_height_ area of dst to convert into: dst itself,
+  // or a view of the letterbox content. Null on allocation failure.
+  AVFrame *content_frame(AVFrame *dst);
+  bool letterboxed() const;
+
+  AVPixelFormat format_;
+  int out_width_; // Converted size, the content area when letterboxing
+  int out_height_;
+
+private:
+  int width_;
+  int height_;
+  AVBufferPool *pool_;
+  AVFrame *sw_frame_; // Download target for hardware frames
+  bool map_hw_frames_;
+
+  // Letterbox canvas (0 when disabled) and the current placement
+  int canvas_width_;
+  int canvas_height_;
+  int pad_value_;
+  LetterboxTransform letterbox_;
+  AVFrame *content_view_;
+
+  // Source the converter was configured for
+  int src_width_;
+  int src_height_;
+  int src_format_;
+  int src_colorspace_;
+  int src_range_;
+  bool configured_;
+};
+
+#endif // FRAME_CONVERTER_H
@@ -0,0 +1,92 @@
+#include "frame_dedup.h"
+
+#include <string.h>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__) && defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+// Sum of absolute differences of two byte arrays.
+static uint64_t sad_u8(const uint8_t *a, const uint8_t *b, size_t size) {
+  uint64_t sum = 0;
+  size_t i = 0;
+#if defined(__aarch64__) && defined(__ARM_NEON)
+  while (i + 16 <= size) {
+    // Each 16-bit lane gains up to 510 per block: flush every 128 blocks.
+    uint16x8_t acc = vdupq_n_u16(0);
+    for (int n = 0; n < 128 && i + 16 <= size; n++, i += 16) {
+      acc = vpadalq_u8(acc, vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i)));
+    }
+    sum += vaddlvq_u16(acc);
+  }
+#elif defined(__SSE2__) && defined(__x86_64__)
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 16 <= size; i += 16) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+  }
+  sum = static_cast<uint64_t>(_mm_cvtsi128_si64(acc)) +
+        static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(acc, acc)));
+#endif
+  for (; i < size; i++) {
+    sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+  }
+  return sum;
+}
+
+// DuplicateFrameFilter Class Implementation
+DuplicateFrameFilter::DuplicateFrameFilter(int thumb_width, int thumb_height,
+                                           double threshold, int max_skip)
+    : thumbnailer_(thumb_width, thumb_height, false), thumb_(av_frame_alloc()),
+      threshold_(threshold), max_skip_(max_skip), skipped_in_row_(0),
+      last_score_(-1.0), passed_(0), dropped_(0) {
+  thumbnailer_.set_map_hw_frames(true);
+}
+
+DuplicateFrameFilter::~DuplicateFrameFilter() { av_frame_free(&thumb_); }
+
+bool DuplicateFrameFilter::Accept(const AVFrame *src) {
+  if (!thumb_ || !thumbnailer_.Convert(src, thumb_)) {
+    passed_++;
+    return true;
+  }
+  current_.resize(static_cast<size_t>(thumb_->width) * thumb_->height);
+  for (int y = 0; y < thumb_->height; y++) {
+    memcpy(current_.data() + static_cast<size_t>(y) * thumb_->width,
+           thumb_->data[0] + static_cast<ptrdiff_t>(y) * thumb_->linesize[0],
+           thumb_->width);
+  }
+  av_frame_unref(thumb_);
+
+  if (reference_.size() == current_.size() && !current_.empty()) {
+    last_score_ =
+        static_cast<double>(sad_u8(current_.data(), reference_.data(),
+                                   current_.size())) /
+        current_.size();
+    if (last_score_ <= threshold_ &&
+        (max_skip_ <= 0 || skipped_in_row_ < max_skip_)) {
+      skipped_in_row_++;
+      dropped_++;
+      return false;
+    }
+  }
+  reference_.swap(current_);
+  skipped_in_row_ = 0;
+  passed_++;
+  return true;
+}
+
+void DuplicateFrameFilter::Reset() {
+  reference_.clear();
+  skipped_in_row_ = 0;
+}
+
+// Getter implementations
+double DuplicateFrameFilter::get_last_score() const { return last_score_; }
+
+uint64_t DuplicateFrameFilter::get_passed() const { return passed_; }
+
+uint64_t DuplicateFrameFilter::get_dropped() const { return dropped_; }
@@ -0,0 +1,51 @@
+#ifndef FRAME_DEDUP_H
+#define FRAME_DEDUP_H
+
+#include <stdint.h>
+
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include "yuv_converter.h"
+
+// Drops near-duplicate frames before they are filtered and converted: each
+// decoded frame is area averaged into a small luma thumbnail (the luma
+// converter, reading hardware frames in place where they can be mapped) and
+// compared with the thumbnail of the last frame let through by mean absolute
+// difference (SIMD SAD). Fixed cameras produce long runs of such frames.
+class DuplicateFrameFilter {
+public:
+  // threshold is the mean absolute difference (0-255) at or below which a
+  // frame is dropped; max_skip > 0 lets a frame through after that many
+  // drops in a row.
+  DuplicateFrameFilter(int thumb_width, int thumb_height, double threshold,
+                       int max_skip);
+  ~DuplicateFrameFilter();
+
+  // False drops src. Frames that cannot be thumbnailed always pass.
+  bool Accept(const AVFrame *src);
+  // The next frame passes, e.g. after a seek.
+  void Reset();
+
+  // Getter methods
+  double get_last_score() const; // -1 until two frames were compared
+  uint64_t get_passed() const;
+  uint64_t get_dropped() const;
+
+private:
+  LumaConverter thumbnailer_;
+  AVFrame *thumb_;
+  const double threshold_;
+  const int max_skip_;
+  std::vector<uint8_t> current_;
+  std::vector<uint8_t> reference_; // Thumbnail of the last frame let through
+  int skipped_in_row_;
+  double last_score_;
+  uint64_t passed_;
+  uint64_t dropped_;
+};
+
+#endif // FRAME_DEDUP_H
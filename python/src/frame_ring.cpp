@@ -0,0 +1,373 @@
+#include "frame_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <climits>
+#include <iostream>
+#include <new>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
+static const uint32_t kRingMagic = 0x46524e47; // "FRNG"
+static const uint32_t kRingVersion = 1;
+static const size_t kRingAlign = 64;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+              "Shared memory atomics must be lock free");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "The futex word must be a plain 32-bit integer");
+
+// Shared memory layout: the header, the slot headers, then the slot data,
+// each 64-byte aligned.
+struct FrameRingHeader {
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint32_t slots;
+  uint32_t reserved;
+  uint64_t slot_size;   // Usable bytes per slot
+  uint64_t slot_stride; // Distance between slots
+  uint64_t data_offset;
+  std::atomic<uint64_t> head;    // Seq of the newest complete frame
+  std::atomic<uint32_t> futex;   // Bumped after every frame and on close
+  std::atomic<uint32_t> waiters; // Readers blocked on futex
+  std::atomic<uint32_t> closed;
+};
+
+struct FrameRingSlot {
+  std::atomic<uint64_t> seq; // 2 * seq - 1 while written, 2 * seq once done
+  int32_t frame_id;
+  int32_t format;
+  int32_t width;
+  int32_t height;
+  int64_t pts;
+  double time_seconds;
+};
+
+static size_t align_up(size_t value) {
+  return (value + kRingAlign - 1) & ~(kRingAlign - 1);
+}
+
+static std::string shm_name(const std::string &name) {
+  return !name.empty() && name[0] == '/' ? name : "/" + name;
+}
+
+static FrameRingSlot *ring_slots(FrameRingHeader *header) {
+  return reinterpret_cast<FrameRingSlot *>(
+      reinterpret_cast<uint8_t *>(header) + align_up(sizeof(*header)));
+}
+
+static uint8_t *slot_data(FrameRingHeader *header, uint64_t seq) {
+  return reinterpret_cast<uint8_t *>(header) + header->data_offset +
+         (seq - 1) % header->slots * header->slot_stride;
+}
+
+static long futex(std::atomic<uint32_t> *word, int op, uint32_t value,
+                  const struct timespec *timeout) {
+  return syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), op, value,
+                 timeout, nullptr, 0);
+}
+
+static void wake_readers(FrameRingHeader *header) {
+  header->futex.fetch_add(1);
+  if (header->waiters.load() > 0) {
+    futex(&header->futex, FUTEX_WAKE, INT_MAX, nullptr);
+  }
+}
+
+static int64_t monotonic_us() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+// FrameRingWriter Class Implementation
+FrameRingWriter::FrameRingWriter()
+    : header_(nullptr), map_size_(0), oversize_reported_(false) {}
+
+FrameRingWriter::~FrameRingWriter() { Close(); }
+
+bool FrameRingWriter::Create(const std::string &name, int slots,
+                             size_t slot_size) {
+  Close();
+  oversize_reported_ = false;
+  if (slots < 2 || slot_size == 0) {
+    std::cerr << "A frame ring needs at least 2 slots of non-zero size."
+              << std::endl;
+    return false;
+  }
+  std::string ring_name = shm_name(name);
+  shm_unlink(ring_name.c_str()); // Stale ring of a crashed writer
+  int fd = shm_open(ring_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    std::cerr << "Failed to create frame ring " << ring_name << ": "
+              << strerror(errno) << std::endl;
+    return false;
+  }
+
+  size_t data_offset =
+      align_up(align_up(sizeof(FrameRingHeader)) +
+               static_cast<size_t>(slots) * sizeof(FrameRingSlot));
+  size_t slot_stride = align_up(slot_size);
+  size_t map_size = data_offset + static_cast<size_t>(slots) * slot_stride;
+  void *mem = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(map_size)) == 0) {
+    mem = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  int map_errno = errno;
+  close(fd);
+  if (mem == MAP_FAILED) {
+    std::cerr << "Failed to map frame ring " << ring_name << ": "
+              << strerror(map_errno) << std::endl;
+    shm_unlink(ring_name.c_str());
+    return false;
+  }
+
+  header_ = new (mem) FrameRingHeader();
+  header_->version = kRingVersion;
+  header_->slots = static_cast<uint32_t>(slots);
+  header_->slot_size = slot_size;
+  header_->slot_stride = slot_stride;
+  header_->data_offset = data_offset;
+  FrameRingSlot *slot_headers = ring_slots(header_);
+  for (int i = 0; i < slots; i++) {
+    new (&slot_headers[i]) FrameRingSlot();
+  }
+  header_->magic.store(kRingMagic, std::memory_order_release);
+  name_ = ring_name;
+  map_size_ = map_size;
+#if !NDEBUG
+  std::cout << "Frame ring " << name_ << ": " << slots << " slots of "
+            << slot_size << " bytes." << std::endl;
+#endif
+  return true;
+}
+
+bool FrameRingWriter::Write(const AVFrame *src, int frame_id,
+                            double time_seconds) {
+  if (!header_) {
+    return false;
+  }
+  AVPixelFormat format = static_cast<AVPixelFormat>(src->format);
+  int size = av_image_get_buffer_size(format, src->width, src->height, 1);
+  if (src->hw_frames_ctx || size < 0 ||
+      static_cast<uint64_t>(size) > header_->slot_size) {
+    if (!oversize_reported_) {
+      std::cerr << "Frame does not fit the frame ring slots (" << size
+                << " > " << header_->slot_size
+                << " bytes, or a hardware frame), skipping such frames. "
+                   "Size the slots for the largest output with "
+                   "shm_ring_slot_size."
+                << std::endl;
+      oversize_reported_ = true;
+    }
+    return false;
+  }
+
+  uint64_t seq = header_->head.load(std::memory_order_relaxed) + 1;
+  FrameRingSlot &slot = ring_slots(header_)[(seq - 1) % header_->slots];
+  slot.seq.store(2 * seq - 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.frame_id = frame_id;
+  slot.format = src->format;
+  slot.width = src->width;
+  slot.height = src->height;
+  slot.pts = src->pts;
+  slot.time_seconds = time_seconds;
+  av_image_copy_to_buffer(slot_data(header_, seq), size, src->data,
+                          src->linesize, format, src->width, src->height, 1);
+  slot.seq.store(2 * seq, std::memory_order_release);
+  header_->head.store(seq, std::memory_order_release);
+  wake_readers(header_);
+  return true;
+}
+
+void FrameRingWriter::Close() {
+  if (!header_) {
+    return;
+  }
+  header_->closed.store(1);
+  wake_readers(header_);
+  munmap(header_, map_size_);
+  shm_unlink(name_.c_str()); // Readers keep their mappings
+  header_ = nullptr;
+  map_size_ = 0;
+}
+
+// Getter implementations
+bool FrameRingWriter::isOpen() const { return header_ != nullptr; }
+
+const std::string &FrameRingWriter::get_name() const { return name_; }
+
+int FrameRingWriter::get_slots() const {
+  return header_ ? static_cast<int>(header_->slots) : 0;
+}
+
+size_t FrameRingWriter::get_slot_size() const {
+  return header_ ? header_->slot_size : 0;
+}
+
+// FrameRingReader Class Implementation
+FrameRingReader::FrameRingReader()
+    : header_(nullptr), map_size_(0), next_seq_(1), dropped_(0) {}
+
+FrameRingReader::~FrameRingReader() { Close(); }
+
+bool FrameRingReader::Open(const std::string &name) {
+  Close();
+  std::string ring_name = shm_name(name);
+  // Read-write: blocked readers register in the header.
+  int fd = shm_open(ring_name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    std::cerr << "Failed to open frame ring " << ring_name << ": "
+              << strerror(errno) << std::endl;
+    return false;
+  }
+  struct stat st;
+  void *mem = MAP_FAILED;
+  if (fstat(fd, &st) == 0 &&
+      static_cast<size_t>(st.st_size) >= sizeof(FrameRingHeader)) {
+    mem = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+               0);
+  }
+  close(fd);
+  if (mem == MAP_FAILED) {
+    std::cerr << "Failed to map frame ring " << ring_name << "." << std::endl;
+    return false;
+  }
+
+  FrameRingHeader *header = static_cast<FrameRingHeader *>(mem);
+  if (header->magic.load(std::memory_order_acquire) != kRingMagic ||
+      header->version != kRingVersion ||
+      header->data_offset + header->slots * header->slot_stride >
+          static_cast<uint64_t>(st.st_size)) {
+    std::cerr << "Not a frame ring (or an incompatible version): "
+              << ring_name << std::endl;
+    munmap(mem, st.st_size);
+    return false;
+  }
+  header_ = header;
+  map_size_ = st.st_size;
+  // Start at the newest frame.
+  uint64_t head = header_->head.load(std::memory_order_acquire);
+  next_seq_ = head > 0 ? head : 1;
+  dropped_ = 0;
+  return true;
+}
+
+FrameRingSlot *FrameRingReader::slot(uint64_t seq) const {
+  return &ring_slots(header_)[(seq - 1) % header_->slots];
+}
+
+bool FrameRingReader::Read(AVFrame *frame, FrameRingInfo &info,
+                           int timeout_ms) {
+  if (!header_) {
+    return false;
+  }
+  int64_t deadline_us =
+      timeout_ms < 0 ? -1 : monotonic_us() + timeout_ms * int64_t(1000);
+  for (;;) {
+    uint32_t futex_value = header_->futex.load();
+    uint64_t head = header_->head.load(std::memory_order_acquire);
+    if (head >= next_seq_) {
+      // The slot after head is being overwritten; lagging readers jump to
+      // the newest frame.
+      if (head - next_seq_ >= header_->slots - 1) {
+        dropped_ += head - next_seq_;
+        next_seq_ = head;
+      }
+      uint64_t seq = next_seq_++;
+      FrameRingSlot *ring_slot = slot(seq);
+      if (ring_slot->seq.load(std::memory_order_acquire) != 2 * seq) {
+        dropped_++; // Lapped meanwhile
+        continue;
+      }
+      info.seq = seq;
+      info.frame_id = ring_slot->frame_id;
+      info.pts = ring_slot->pts;
+      info.time_seconds = ring_slot->time_seconds;
+      frame->format = ring_slot->format;
+      frame->width = ring_slot->width;
+      frame->height = ring_slot->height;
+      frame->pts = ring_slot->pts;
+      int ret = av_image_fill_arrays(
+          frame->data, frame->linesize, slot_data(header_, seq),
+          static_cast<AVPixelFormat>(frame->format), frame->width,
+          frame->height, 1);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (ring_slot->seq.load(std::memory_order_relaxed) != 2 * seq) {
+        dropped_++;
+        continue;
+      }
+      return ret >= 0;
+    }
+    if (header_->closed.load()) {
+      return false;
+    }
+    if (!wait(futex_value, deadline_us)) {
+      return false;
+    }
+  }
+}
+
+// Blocks until the futex word moves away from futex_value, or the deadline
+// (monotonic, -1 for none) passes.
+bool FrameRingReader::wait(uint32_t futex_value, int64_t deadline_us) {
+  struct timespec timeout;
+  struct timespec *timeout_ptr = nullptr;
+  if (deadline_us >= 0) {
+    int64_t left_us = deadline_us - monotonic_us();
+    if (left_us <= 0) {
+      return false;
+    }
+    timeout.tv_sec = left_us / 1000000;
+    timeout.tv_nsec = (left_us % 1000000) * 1000;
+    timeout_ptr = &timeout;
+  }
+  header_->waiters.fetch_add(1);
+  long ret = futex(&header_->futex, FUTEX_WAIT, futex_value, timeout_ptr);
+  int wait_errno = errno;
+  header_->waiters.fetch_sub(1);
+  return ret == 0 || wait_errno != ETIMEDOUT;
+}
+
+bool FrameRingReader::IsCurrent(uint64_t seq) const {
+  return header_ && seq > 0 &&
+         slot(seq)->seq.load(std::memory_order_acquire) == 2 * seq;
+}
+
+void FrameRingReader::Close() {
+  if (header_) {
+    munmap(header_, map_size_);
+    header_ = nullptr;
+    map_size_ = 0;
+  }
+}
+
+// Getter implementations
+bool FrameRingReader::isOpen() const { return header_ != nullptr; }
+
+bool FrameRingReader::isWriterClosed() const {
+  return header_ && header_->closed.load();
+}
+
+int FrameRingReader::get_slots() const {
+  return header_ ? static_cast<int>(header_->slots) : 0;
+}
+
+uint64_t FrameRingReader::get_head() const {
+  return header_ ? header_->head.load(std::memory_order_acquire) : 0;
+}
+
+uint64_t FrameRingReader::get_dropped() const { return dropped_; }
@@ -0,0 +1,91 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+struct FrameRingHeader;
+struct FrameRingSlot;
+
+// Metadata of a frame in the ring. seq counts the frames written, from 1.
+struct FrameRingInfo {
+  uint64_t seq = 0;
+  int frame_id = 0;
+  int64_t pts = 0;
+  double time_seconds = 0.0;
+};
+
+// Writer side of a frame ring in POSIX shared memory (shm_open): a fixed
+// number of slots, each holding one frame packed with av_image_copy_to_buffer
+// and guarded by a per-slot sequence number (odd while being written). The
+// writer never waits for readers; it bumps a futex word after each frame to
+// wake readers blocked in FrameRingReader::Read().
+class FrameRingWriter {
+public:
+  FrameRingWriter();
+  ~FrameRingWriter(); // Marks the ring closed and unlinks its name
+
+  // name is a shm_open name ("/" is prepended if missing). Replaces a stale
+  // ring of the same name.
+  bool Create(const std::string &name, int slots, size_t slot_size);
+  // Copies src into the next slot. Fails for frames larger than a slot,
+  // reporting only the first of them.
+  bool Write(const AVFrame *src, int frame_id, double time_seconds);
+  void Close();
+
+  // Getter methods
+  bool isOpen() const;
+  const std::string &get_name() const;
+  int get_slots() const;
+  size_t get_slot_size() const;
+
+private:
+  std::string name_;
+  FrameRingHeader *header_;
+  size_t map_size_;
+  bool oversize_reported_;
+};
+
+// Maps a ring created by a FrameRingWriter, possibly in another process.
+// Frames are read in place: the data returned by Read() stays valid until
+// the writer laps the ring (slots - 1 frames later); IsCurrent() tells
+// whether it was overwritten since.
+class FrameRingReader {
+public:
+  FrameRingReader();
+  ~FrameRingReader();
+
+  bool Open(const std::string &name);
+  // Waits up to timeout_ms (-1 waits forever) for the frame after the last
+  // one read and points frame (format, size, data, linesize, not owned) at
+  // its slot. A reader that fell behind by a full ring skips to the newest
+  // frame. Returns false on timeout, or once the writer closed the ring and
+  // every frame was read.
+  bool Read(AVFrame *frame, FrameRingInfo &info, int timeout_ms = -1);
+  bool IsCurrent(uint64_t seq) const;
+  void Close();
+
+  // Getter methods
+  bool isOpen() const;
+  bool isWriterClosed() const;
+  int get_slots() const;
+  uint64_t get_head() const;    // Frames written so far
+  uint64_t get_dropped() const; // Frames skipped because the reader lagged
+
+private:
+  FrameRingHeader *header_;
+  size_t map_size_;
+  uint64_t next_seq_;
+  uint64_t dropped_;
+
+  FrameRingSlot *slot(uint64_t seq) const;
+  bool wait(uint32_t futex_value, int64_t deadline_us);
+};
+
+#endif // FRAME_RING_H
@@ -0,0 +1,66 @@
+#ifndef FRAME_SERVER_PROTOCOL_H
+#define FRAME_SERVER_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Wire format between the frame server (cpp/frame-server.cpp) and
+// FrameClient, over a SOCK_SEQPACKET Unix socket. A client sends one
+// subscription, the server answers Accepted or Rejected, then sends one
+// Frame message per frame with a sealed memfd holding the pixels (packed
+// with av_image_copy_to_buffer, align 1) attached via SCM_RIGHTS. The client
+// sends a Release once it unmapped a frame; the server drops frames for
+// clients with max_inflight frames unreleased.
+
+static const uint32_t kFrameServerMagic = 0x46535256; // "FSRV"
+static const uint32_t kFrameServerVersion = 1;
+static const size_t kFrameServerStreamNameSize = 256;
+
+enum FrameServerMessageType : uint32_t {
+  kFrameServerAccepted = 1,
+  kFrameServerRejected = 2, // Unknown stream or failed open
+  kFrameServerFrame = 3,    // Carries the frame memfd
+  kFrameServerEnd = 4,      // The stream ended
+};
+
+// Client -> server, once after connecting.
+struct FrameServerSubscribe {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t max_inflight;
+  uint32_t reserved;
+  char stream[kFrameServerStreamNameSize]; // NUL terminated
+};
+
+// Server -> client.
+struct FrameServerMessage {
+  uint32_t magic;
+  uint32_t type; // FrameServerMessageType
+  uint64_t seq;  // Frames published on the stream, from 1
+  int32_t frame_id;
+  int32_t format; // AVPixelFormat
+  int32_t width;
+  int32_t height;
+  int64_t pts;
+  double time_seconds;
+  uint64_t size; // memfd bytes
+};
+
+// Client -> server, once done with frame seq.
+struct FrameServerRelease {
+  uint32_t magic;
+  uint32_t reserved;
+  uint64_t seq;
+};
+
+// Sends a message, with fd attached unless it is -1. Returns false when the
+// message could not be sent (for nonblocking sockets also when the socket
+// buffer is full).
+bool SendFrameServerMessage(int socket_fd, const void *message, size_t size,
+                            int fd, int flags);
+// Receives a message of exactly size bytes and the attached fd, if any
+// (else fd is -1). Returns false on errors, size mismatch or hangup.
+bool ReceiveFrameServerMessage(int socket_fd, void *message, size_t size,
+                               int &fd);
+
+#endif // FRAME_SERVER_PROTOCOL_H
@@ -0,0 +1,93 @@
+#include "frame_stats.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+// Sum and sum of squares of the Laplacian of row y (1 <= y < height - 1)
+// over columns [1, width - 1). Plain integer loops, vectorized by the
+// compiler.
+static void laplacian_row(const uint8_t *up, const uint8_t *row,
+                          const uint8_t *down, int width, int64_t &sum,
+                          int64_t &sum_sq) {
+  int64_t row_sum = 0;
+  int64_t row_sum_sq = 0;
+  for (int x = 1; x < width - 1; x++) {
+    int lap = up[x] + down[x] + row[x - 1] + row[x + 1] - 4 * row[x];
+    row_sum += lap;
+    row_sum_sq += lap * lap;
+  }
+  sum += row_sum;
+  sum_sq += row_sum_sq;
+}
+
+// FrameStatsCalculator Class Implementation
+FrameStatsCalculator::FrameStatsCalculator(int width, int height, int bins)
+    : luma_(width, height, false), luma_frame_(av_frame_alloc()),
+      bins_(bins) {
+  luma_.set_map_hw_frames(true);
+}
+
+FrameStatsCalculator::~FrameStatsCalculator() { av_frame_free(&luma_frame_); }
+
+bool FrameStatsCalculator::Compute(const AVFrame *src, FrameStats &stats) {
+  if (!luma_frame_ || !luma_.Convert(src, luma_frame_)) {
+    return false;
+  }
+  ComputePlane(luma_frame_->data[0], luma_frame_->linesize[0],
+               luma_frame_->width, luma_frame_->height, bins_, stats);
+  av_frame_unref(luma_frame_);
+  return true;
+}
+
+void FrameStatsCalculator::ComputePlane(const uint8_t *plane, int linesize,
+                                        int width, int height, int bins,
+                                        FrameStats &stats) {
+  // Four interleaved histograms avoid stalls on runs of equal pixels.
+  uint32_t counts[4][256];
+  memset(counts, 0, sizeof(counts));
+  int64_t lap_sum = 0;
+  int64_t lap_sum_sq = 0;
+  for (int y = 0; y < height; y++) {
+    const uint8_t *row = plane + static_cast<ptrdiff_t>(y) * linesize;
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+      counts[0][row[x]]++;
+      counts[1][row[x + 1]]++;
+      counts[2][row[x + 2]]++;
+      counts[3][row[x + 3]]++;
+    }
+    for (; x < width; x++) {
+      counts[0][row[x]]++;
+    }
+    if (y > 0 && y < height - 1) {
+      laplacian_row(row - linesize, row, row + linesize, width, lap_sum,
+                    lap_sum_sq);
+    }
+  }
+
+  bins = bins > 0 && bins <= 256 ? bins : 256;
+  stats.histogram.assign(bins, 0);
+  double sum = 0.0;
+  double sum_sq = 0.0;
+  for (int v = 0; v < 256; v++) {
+    uint32_t count = counts[0][v] + counts[1][v] + counts[2][v] + counts[3][v];
+    stats.histogram[v * bins / 256] += count;
+    sum += static_cast<double>(v) * count;
+    sum_sq += static_cast<double>(v) * v * count;
+  }
+  double pixels = static_cast<double>(width) * height;
+  stats.mean = pixels > 0 ? sum / pixels : 0.0;
+  stats.stddev =
+      pixels > 0 ? sqrt(std::max(sum_sq / pixels - stats.mean * stats.mean,
+                                 0.0))
+                 : 0.0;
+  double inner = static_cast<double>(width - 2) * (height - 2);
+  if (inner > 0) {
+    double lap_mean = lap_sum / inner;
+    stats.laplacian_var = lap_sum_sq / inner - lap_mean * lap_mean;
+  } else {
+    stats.laplacian_var = 0.0;
+  }
+}
@@ -0,0 +1,45 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <stdint.h>
+
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include "yuv_converter.h"
+
+// Statistics of the luma plane of a frame.
+struct FrameStats {
+  double mean = 0.0;
+  double stddev = 0.0;        // Contrast
+  double laplacian_var = 0.0; // Sharpness, low for blurry frames
+  std::vector<uint32_t> histogram;
+};
+
+// Computes FrameStats over the luma plane of decoded frames, taken by the
+// luma converter (no copy at the source size; hardware frames are read in
+// place where they can be mapped). One pass over the rows builds a 256-bin
+// histogram, from which mean and deviation follow, and the variance of the
+// 4-neighbour Laplacian.
+class FrameStatsCalculator {
+public:
+  // width/height 0 keeps the source size; 1 to 256 histogram bins.
+  FrameStatsCalculator(int width, int height, int bins);
+  ~FrameStatsCalculator();
+
+  bool Compute(const AVFrame *src, FrameStats &stats);
+
+  // Stats of an 8-bit plane.
+  static void ComputePlane(const uint8_t *plane, int linesize, int width,
+                           int height, int bins, FrameStats &stats);
+
+private:
+  LumaConverter luma_;
+  AVFrame *luma_frame_;
+  const int bins_;
+};
+
+#endif // FRAME_STATS_H
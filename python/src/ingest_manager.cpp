@@ -0,0 +1,291 @@
+#include "ingest_manager.h"
+
+#include <algorithm>
+#include <chrono>
+
+// Poll interval for non-blocking inputs without data
+static const int64_t kInputPollUs = 5000;
+// Longest a worker sleeps before re-checking the camera table
+static const int64_t kMaxIdleUs = 100000;
+
+// IngestManager Class Implementation
+IngestManager::IngestManager(int num_threads)
+    : num_threads_(std::max(num_threads, 1)), max_lag_ms_(200),
+      min_reconnect_delay_ms_(500), max_reconnect_delay_ms_(10000),
+      stopping_(false) {}
+
+IngestManager::~IngestManager() { Stop(); }
+
+bool IngestManager::AddCamera(const std::string &cam_id,
+                              const std::string &filename,
+                              const std::string &filter_descr_str,
+                              const FFMPEGVideoOptions &options,
+                              bool realtime) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &camera : cameras_) {
+    if (camera->cam_id == cam_id) {
+      std::cerr << "Camera '" << cam_id << "' already exists." << std::endl;
+      return false;
+    }
+  }
+
+  // The input is opened by a worker, so a slow connect blocks nobody else.
+  auto camera = std::make_shared<Camera>();
+  camera->cam_id = cam_id;
+  camera->filename = filename;
+  camera->filter_descr = filter_descr_str;
+  camera->options = options;
+  // Never hold a pool worker waiting for a decoder session, a camera that
+  // gets none retries with the reconnect backoff.
+  camera->options.session_wait_ms = 0;
+  camera->realtime = realtime;
+  camera->next_due_us = av_gettime_relative();
+  camera->stats.cam_id = cam_id;
+  cameras_.push_back(camera);
+  work_ready_.notify_one();
+  return true;
+}
+
+bool IngestManager::RemoveCamera(const std::string &cam_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = cameras_.begin(); it != cameras_.end(); ++it) {
+    if ((*it)->cam_id == cam_id) {
+      // A busy worker keeps its own reference until the step completes.
+      cameras_.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+void IngestManager::Start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!workers_.empty()) {
+    return;
+  }
+  stopping_ = false;
+  for (int i = 0; i < num_threads_; i++) {
+    workers_.emplace_back(&IngestManager::run, this);
+  }
+}
+
+void IngestManager::Stop() {
+  std::vector<std::thread> workers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    workers.swap(workers_);
+    work_ready_.notify_all();
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+bool IngestManager::GetLatest(const std::string &cam_id,
+                              VideoFrame &output_frame) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &camera : cameras_) {
+    if (camera->cam_id == cam_id) {
+      if (!camera->latest.av) {
+        return false;
+      }
+      output_frame = camera->latest;
+      return true;
+    }
+  }
+  return false;
+}
+
+void IngestManager::set_max_lag_ms(int max_lag_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_lag_ms_ = max_lag_ms;
+}
+
+void IngestManager::set_reconnect_delay_ms(int min_delay_ms,
+                                           int max_delay_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  min_reconnect_delay_ms_ = std::max(min_delay_ms, 0);
+  max_reconnect_delay_ms_ = std::max(max_delay_ms, min_reconnect_delay_ms_);
+}
+
+bool IngestManager::isRunning() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return !workers_.empty();
+}
+
+int IngestManager::get_num_threads() const { return num_threads_; }
+
+std::vector<std::string> IngestManager::get_camera_ids() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> cam_ids;
+  for (const auto &camera : cameras_) {
+    cam_ids.push_back(camera->cam_id);
+  }
+  return cam_ids;
+}
+
+std::vector<CameraStats> IngestManager::get_stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  int64_t now_us = av_gettime_relative();
+  std::vector<CameraStats> stats;
+  for (const auto &camera : cameras_) {
+    stats.push_back(camera->stats);
+    // A stalled camera has no window completing to bring its rate down.
+    if (now_us - camera->fps_window_start_us > 2000000) {
+      stats.back().fps = 0.0;
+    }
+  }
+  return stats;
+}
+
+void IngestManager::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    int64_t wait_us = kMaxIdleUs;
+    std::shared_ptr<Camera> camera =
+        next_camera(av_gettime_relative(), wait_us);
+    if (!camera) {
+      work_ready_.wait_for(lock, std::chrono::microseconds(wait_us));
+      continue;
+    }
+
+    camera->busy = true;
+    lock.unlock();
+    step(*camera);
+    lock.lock();
+    camera->busy = false;
+    work_ready_.notify_one();
+  }
+}
+
+std::shared_ptr<IngestManager::Camera>
+IngestManager::next_camera(int64_t now_us, int64_t &wait_us) {
+  // Earliest deadline first. A camera that just ran moves its deadline
+  // forward, so ready cameras are served in turn.
+  std::shared_ptr<Camera> next;
+  for (const auto &camera : cameras_) {
+    if (camera->busy) {
+      continue;
+    }
+    if (camera->next_due_us > now_us) {
+      wait_us = std::min(wait_us, camera->next_due_us - now_us);
+    } else if (!next || camera->next_due_us < next->next_due_us) {
+      next = camera;
+    }
+  }
+  return next;
+}
+
+void IngestManager::step(Camera &camera) {
+  // (Re)connect
+  if (!camera.video) {
+    auto video = std::make_unique<FFMPEGVideo>(
+        camera.filename, camera.filter_descr, camera.options);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!video->isInitialized()) {
+      std::cerr << "Camera '" << camera.cam_id << "' failed to open."
+                << std::endl;
+      schedule_reconnect(camera);
+      return;
+    }
+    camera.video = std::move(video);
+    camera.clock.reset();
+    camera.stats.connected = true;
+    camera.was_connected = true;
+    camera.reconnect_delay_ms = 0;
+    camera.next_due_us = av_gettime_relative();
+    return;
+  }
+
+  // A paced frame that became due
+  if (camera.pending_frame) {
+    convert(camera, camera.pending_frame.get(), camera.pending_capture_us);
+    camera.pending_frame.reset();
+  }
+
+  std::shared_ptr<AVFrame> decoded_frame;
+  if (!camera.video->DecodeFrame(decoded_frame)) {
+    // Non-blocking input without a packet yet is not the end of it.
+    bool waiting = camera.video->isWaitingForInput();
+    if (!waiting) {
+      // EOF or error: drop the input and reopen it later.
+      camera.video.reset();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (waiting) {
+      camera.next_due_us = av_gettime_relative() + kInputPollUs;
+      return;
+    }
+    camera.stats.connected = false;
+    schedule_reconnect(camera);
+    return;
+  }
+
+  int64_t capture_us = camera.clock.due_time_us(
+      decoded_frame->pts, camera.video->get_time_base());
+  int64_t now_us = av_gettime_relative();
+  std::unique_lock<std::mutex> lock(mutex_);
+  camera.stats.frames_decoded++;
+
+  if (camera.realtime && capture_us > now_us) {
+    // Keep it until it would have been captured, freeing the worker.
+    camera.pending_frame = std::move(decoded_frame);
+    camera.pending_capture_us = capture_us;
+    camera.next_due_us = capture_us;
+    return;
+  }
+
+  camera.next_due_us = now_us;
+  if (now_us - capture_us > max_lag_ms_ * 1000LL) {
+    // Behind schedule: decode (references need it) but skip conversion.
+    camera.stats.frames_skipped++;
+    return;
+  }
+  lock.unlock();
+  convert(camera, decoded_frame.get(), capture_us);
+}
+
+void IngestManager::convert(Camera &camera, const AVFrame *decoded_frame,
+                            int64_t capture_us) {
+  std::vector<VideoFrame> frames;
+  if (camera.video->FilterFrame(decoded_frame, frames) < 0) {
+    return;
+  }
+
+  int64_t now_us = av_gettime_relative();
+  double latency_ms = (now_us - capture_us) / 1000.0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  camera.latest = frames[0];
+  CameraStats &stats = camera.stats;
+  stats.frames_converted++;
+  stats.latency_last_ms = latency_ms;
+  camera.latency_sum_ms += latency_ms;
+  stats.latency_avg_ms = camera.latency_sum_ms / stats.frames_converted;
+
+  if (camera.fps_window_start_us == 0) {
+    camera.fps_window_start_us = now_us; // First window starts here
+    return;
+  }
+  camera.fps_window_frames++;
+  int64_t window_us = now_us - camera.fps_window_start_us;
+  if (window_us >= 1000000) {
+    stats.fps = camera.fps_window_frames * 1e6 / window_us;
+    camera.fps_window_start_us = now_us;
+    camera.fps_window_frames = 0;
+  }
+}
+
+void IngestManager::schedule_reconnect(Camera &camera) {
+  camera.pending_frame.reset();
+  if (camera.was_connected) {
+    camera.stats.reconnects++; // Not while it never opened
+  }
+  camera.reconnect_delay_ms =
+      camera.reconnect_delay_ms == 0
+          ? min_reconnect_delay_ms_
+          : std::min<int64_t>(camera.reconnect_delay_ms * 2,
+                              max_reconnect_delay_ms_);
+  camera.next_due_us =
+      av_gettime_relative() + camera.reconnect_delay_ms * 1000LL;
+}
@@ -0,0 +1,109 @@
+#ifndef INGEST_MANAGER_H
+#define INGEST_MANAGER_H
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ffmpeg_video.h"
+#include "live_video.h"
+
+struct CameraStats {
+  std::string cam_id;
+  bool connected = false;
+  uint64_t frames_decoded = 0;
+  uint64_t frames_converted = 0;
+  uint64_t frames_skipped = 0; // Decoded too late, conversion skipped
+  uint64_t reconnects = 0; // Reopen attempts after a lost connection
+  double fps = 0.0; // Converted frames per second, over the last second
+  double latency_last_ms = 0.0; // Capture (PTS) to latest() availability
+  double latency_avg_ms = 0.0;
+};
+
+// Owns a set of live inputs and runs their demux/decode/convert steps on a
+// small shared thread pool. Each step handles one frame of one camera; the
+// camera with the earliest deadline goes first, so every input gets its
+// turn. Inputs that hit EOF or an error are reopened with backoff without
+// holding up the others.
+class IngestManager {
+public:
+  explicit IngestManager(int num_threads = 4);
+  ~IngestManager();
+
+  // realtime paces a local file by its timestamps, like a live camera.
+  bool AddCamera(const std::string &cam_id, const std::string &filename,
+                 const std::string &filter_descr_str,
+                 const FFMPEGVideoOptions &options = FFMPEGVideoOptions(),
+                 bool realtime = false);
+  bool RemoveCamera(const std::string &cam_id);
+  void Start();
+  void Stop();
+
+  // Returns the newest converted frame of a camera, without waiting.
+  bool GetLatest(const std::string &cam_id, VideoFrame &output_frame) const;
+
+  // Frames older than this (capture to decode) skip conversion, letting a
+  // lagging camera catch up.
+  void set_max_lag_ms(int max_lag_ms);
+  void set_reconnect_delay_ms(int min_delay_ms, int max_delay_ms);
+
+  // Getter methods
+  bool isRunning() const;
+  int get_num_threads() const;
+  std::vector<std::string> get_camera_ids() const;
+  std::vector<CameraStats> get_stats() const;
+
+private:
+  struct Camera {
+    std::string cam_id;
+    std::string filename;
+    std::string filter_descr;
+    FFMPEGVideoOptions options;
+    bool realtime = false;
+
+    std::unique_ptr<FFMPEGVideo> video; // Only touched while busy
+    PtsClock clock;
+    std::shared_ptr<AVFrame> pending_frame; // Decoded, due at next_due_us
+    int64_t pending_capture_us = 0;
+
+    // Guarded by IngestManager::mutex_
+    bool busy = false;
+    bool was_connected = false; // Later opens count as reconnects
+    int64_t next_due_us = 0;
+    int64_t reconnect_delay_ms = 0;
+    VideoFrame latest;
+    CameraStats stats;
+    double latency_sum_ms = 0.0;
+    int64_t fps_window_start_us = 0; // 0 until the first converted frame
+    uint64_t fps_window_frames = 0;
+  };
+
+  int num_threads_;
+  int max_lag_ms_;
+  int min_reconnect_delay_ms_;
+  int max_reconnect_delay_ms_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable work_ready_;
+  std::vector<std::shared_ptr<Camera>> cameras_;
+  std::vector<std::thread> workers_;
+  bool stopping_;
+
+  // Worker thread body
+  void run();
+  // Picks the ready camera with the earliest deadline (mutex_ held).
+  std::shared_ptr<Camera> next_camera(int64_t now_us, int64_t &wait_us);
+  // One scheduling step of one camera (mutex_ not held).
+  void step(Camera &camera);
+  void convert(Camera &camera, const AVFrame *decoded_frame,
+               int64_t capture_us);
+  void schedule_reconnect(Camera &camera);
+};
+
+#endif // INGEST_MANAGER_H
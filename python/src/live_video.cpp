@@ -0,0 +1,163 @@
+#include "live_video.h"
+
+#include <algorithm>
+#include <chrono>
+
+// Poll interval of a non-blocking input without data
+static const unsigned kInputPollUs = 5000;
+
+// PtsClock Class Implementation
+PtsClock::PtsClock() : first_pts_(AV_NOPTS_VALUE), start_us_(0) {}
+
+void PtsClock::reset() { first_pts_ = AV_NOPTS_VALUE; }
+
+int64_t PtsClock::due_time_us(int64_t pts, AVRational time_base) {
+  int64_t now_us = av_gettime_relative();
+  if (pts == AV_NOPTS_VALUE || time_base.num == 0 || time_base.den == 0) {
+    return now_us;
+  }
+  // Re-anchor on the first frame and whenever timestamps jump backwards
+  // (e.g. a looped file or a restarted camera).
+  if (first_pts_ == AV_NOPTS_VALUE || pts < first_pts_) {
+    first_pts_ = pts;
+    start_us_ = now_us;
+  }
+  return start_us_ + av_rescale_q(pts - first_pts_, time_base, {1, 1000000});
+}
+
+// LiveVideo Class Implementation
+LiveVideo::LiveVideo(const std::string &filename,
+                     const std::string &filter_descr_str,
+                     const FFMPEGVideoOptions &options, bool realtime)
+    : video_(filename, filter_descr_str, options), realtime_(realtime),
+      stopping_(false), running_(false), latest_capture_us_(0),
+      latency_sum_ms_(0.0) {}
+
+LiveVideo::~LiveVideo() { Stop(); }
+
+bool LiveVideo::isInitialized() const { return video_.isInitialized(); }
+
+void LiveVideo::Start() {
+  if (thread_.joinable()) {
+    return;
+  }
+  if (!video_.isInitialized()) {
+    std::cerr << "FFMPEGVideo not initialized. Cannot start live reader."
+              << std::endl;
+    return;
+  }
+  stopping_ = false;
+  running_ = true;
+  thread_ = std::thread(&LiveVideo::run, this);
+}
+
+void LiveVideo::Stop() {
+  stopping_ = true;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+bool LiveVideo::GetLatestFrame(VideoFrame &output_frame, int timeout_ms) {
+  std::vector<VideoFrame> output_frames;
+  if (!GetLatestFrames(output_frames, timeout_ms)) {
+    return false;
+  }
+  output_frame = output_frames[0];
+  return true;
+}
+
+bool LiveVideo::GetLatestFrames(std::vector<VideoFrame> &output_frames,
+                                int timeout_ms) {
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(std::max(timeout_ms, 0));
+  int64_t capture_us;
+  while (true) {
+    std::shared_ptr<AVFrame> decoded_frame;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      auto ready = [this] { return latest_frame_ || !running_; };
+      if (timeout_ms < 0) {
+        frame_ready_.wait(lock, ready);
+      } else if (!frame_ready_.wait_until(lock, deadline, ready)) {
+        return false; // Timed out
+      }
+      if (!latest_frame_) {
+        return false; // Stream ended
+      }
+      decoded_frame = std::move(latest_frame_);
+      capture_us = latest_capture_us_;
+    }
+
+    // Only the frame actually handed out pays for filtering and conversion.
+    int ret = video_.FilterFrame(decoded_frame.get(), output_frames);
+    if (ret == 0) {
+      break;
+    } else if (ret != AVERROR(EAGAIN)) {
+      return false;
+    }
+    // No output yet (held by the filter graph or dropped), wait for the
+    // next frame.
+  }
+
+  double latency_ms = (av_gettime_relative() - capture_us) / 1000.0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.frames_delivered++;
+  stats_.latency_last_ms = latency_ms;
+  stats_.latency_max_ms = std::max(stats_.latency_max_ms, latency_ms);
+  latency_sum_ms_ += latency_ms;
+  stats_.latency_avg_ms = latency_sum_ms_ / stats_.frames_delivered;
+  return true;
+}
+
+bool LiveVideo::isRunning() const { return running_; }
+
+LiveVideoStats LiveVideo::get_stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void LiveVideo::reset_stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_ = LiveVideoStats();
+  latency_sum_ms_ = 0.0;
+}
+
+const FFMPEGVideo &LiveVideo::get_video() const { return video_; }
+
+void LiveVideo::run() {
+  AVRational time_base = video_.get_time_base();
+  std::shared_ptr<AVFrame> decoded_frame;
+
+  while (!stopping_) {
+    if (!video_.DecodeFrame(decoded_frame)) {
+      if (!video_.isWaitingForInput()) {
+        break; // End of stream or error
+      }
+      av_usleep(kInputPollUs);
+      continue;
+    }
+    int64_t capture_us = clock_.due_time_us(decoded_frame->pts, time_base);
+    if (realtime_) {
+      // Hold the frame back until it would have been captured.
+      int64_t wait_us = capture_us - av_gettime_relative();
+      while (!stopping_ && wait_us > 0) {
+        av_usleep(static_cast<unsigned>(std::min<int64_t>(wait_us, 100000)));
+        wait_us = capture_us - av_gettime_relative();
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (latest_frame_) {
+      stats_.frames_superseded++;
+    }
+    latest_frame_ = std::move(decoded_frame);
+    latest_capture_us_ = capture_us;
+    stats_.frames_decoded++;
+    frame_ready_.notify_one();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  running_ = false;
+  frame_ready_.notify_all();
+}
@@ -0,0 +1,90 @@
+#ifndef LIVE_VIDEO_H
+#define LIVE_VIDEO_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ffmpeg_video.h"
+
+// Maps stream timestamps onto the monotonic clock (av_gettime_relative()),
+// anchored at the first frame seen.
+class PtsClock {
+public:
+  PtsClock();
+  void reset();
+  // Returns the time (in microseconds) at which the frame is due.
+  int64_t due_time_us(int64_t pts, AVRational time_base);
+
+private:
+  int64_t first_pts_;
+  int64_t start_us_;
+};
+
+struct LiveVideoStats {
+  uint64_t frames_decoded = 0;
+  uint64_t frames_delivered = 0;
+  uint64_t frames_superseded = 0; // Decoded, but never filtered/converted
+  double latency_last_ms = 0.0;   // Capture (PTS) to delivery
+  double latency_avg_ms = 0.0;
+  double latency_max_ms = 0.0;
+};
+
+// Low latency reader for live inputs: a background thread decodes
+// continuously and keeps only the newest decoded frame. The filter and
+// conversion stage runs on request, so frames superseded before anyone asked
+// for them are never converted.
+class LiveVideo {
+public:
+  // realtime paces the input by its timestamps, to feed a local file like a
+  // live camera.
+  LiveVideo(const std::string &filename, const std::string &filter_descr_str,
+            const FFMPEGVideoOptions &options = FFMPEGVideoOptions(),
+            bool realtime = false);
+  ~LiveVideo();
+
+  bool isInitialized() const;
+  void Start();
+  void Stop();
+
+  // Waits up to timeout_ms (-1 waits forever) for a frame newer than the
+  // last delivered one and converts it; a frame the filter graph holds back
+  // keeps it waiting for the next one. Returns false on timeout, on error or
+  // once the stream ended (then isRunning() is false).
+  bool GetLatestFrame(VideoFrame &output_frame, int timeout_ms = -1);
+  bool GetLatestFrames(std::vector<VideoFrame> &output_frames,
+                       int timeout_ms = -1);
+
+  // Getter methods
+  bool isRunning() const;
+  LiveVideoStats get_stats() const;
+  void reset_stats();
+  const FFMPEGVideo &get_video() const;
+
+private:
+  FFMPEGVideo video_;
+  bool realtime_;
+  PtsClock clock_;
+
+  std::thread thread_;
+  std::atomic<bool> stopping_;
+  std::atomic<bool> running_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable frame_ready_;
+  std::shared_ptr<AVFrame> latest_frame_;
+  int64_t latest_capture_us_;
+  LiveVideoStats stats_;
+  double latency_sum_ms_;
+
+  // Decoder thread body
+  void run();
+};
+
+#endif // LIVE_VIDEO_H
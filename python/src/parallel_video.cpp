@@ -0,0 +1,182 @@
+#include "parallel_video.h"
+
+#include <algorithm>
+
+// ParallelVideo Class Implementation
+ParallelVideo::ParallelVideo(const std::string &filename,
+                             const std::string &filter_descr_str,
+                             const FFMPEGVideoOptions &options, int workers,
+                             int chunks, int queue_frames)
+    : filename_(filename), filter_descr_(filter_descr_str), options_(options),
+      queue_frames_(std::max(queue_frames, 1)), initialized_(false),
+      workers_(0), frame_total_(0), stopping_(false), next_chunk_(0),
+      output_chunk_(0), buffered_(0), max_buffered_(0), frame_id_(0),
+      failed_chunks_(0) {
+  // One ring has one writer.
+  options_.shm_ring_name.clear();
+  workers = std::max(workers, 1);
+  if (chunks <= 0) {
+    chunks = 4 * workers;
+  }
+
+  probe_.reset(new FFMPEGVideo(filename_, filter_descr_, options_));
+  std::vector<int> bounds;
+  if (!probe_->isInitialized() || !probe_->GetShardBounds(chunks, bounds) ||
+      !probe_->GetKeyframeIndex(keyframes_) ||
+      !probe_->GetFrameTimestamps(frame_timestamps_)) {
+    std::cerr << "Failed to split " << filename_ << " into chunks."
+              << std::endl;
+    return;
+  }
+  frame_total_ = bounds.back();
+  for (size_t i = 0; i + 1 < bounds.size(); i++) {
+    if (bounds[i] < bounds[i + 1]) { // Keyframes may merge chunks
+      chunks_.emplace_back();
+      chunks_.back().start = bounds[i];
+      chunks_.back().end = bounds[i + 1];
+    }
+  }
+#if !NDEBUG
+  std::cout << "Decoding " << frame_total_ << " frames in " << chunks_.size()
+            << " chunks with " << workers << " workers." << std::endl;
+#endif
+
+  workers_ = std::min(workers, static_cast<int>(chunks_.size()));
+  for (int i = 0; i < workers_; i++) {
+    threads_.emplace_back(&ParallelVideo::run, this,
+                          i == 0 ? std::move(probe_) : nullptr);
+  }
+  initialized_ = true;
+}
+
+ParallelVideo::~ParallelVideo() { Stop(); }
+
+bool ParallelVideo::isInitialized() const { return initialized_; }
+
+bool ParallelVideo::GetNextFrame(VideoFrame &output_frame) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (output_chunk_ < chunks_.size() && !stopping_) {
+    Chunk &chunk = chunks_[output_chunk_];
+    if (!chunk.frames.empty()) {
+      output_frame = std::move(chunk.frames.front());
+      chunk.frames.pop_front();
+      buffered_--;
+      frame_id_++;
+      changed_.notify_all();
+      return true;
+    } else if (chunk.done) {
+      output_chunk_++; // Lets a worker start another chunk
+      changed_.notify_all();
+    } else {
+      changed_.wait(lock);
+    }
+  }
+  return false;
+}
+
+void ParallelVideo::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    changed_.notify_all();
+  }
+  for (std::thread &thread : threads_) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+  threads_.clear();
+}
+
+void ParallelVideo::run(std::unique_ptr<FFMPEGVideo> video) {
+  while (true) {
+    size_t index;
+    {
+      // Stay within one chunk per worker of the reading position.
+      std::unique_lock<std::mutex> lock(mutex_);
+      changed_.wait(lock, [&] {
+        return stopping_ || next_chunk_ >= chunks_.size() ||
+               next_chunk_ < output_chunk_ + workers_;
+      });
+      if (stopping_ || next_chunk_ >= chunks_.size()) {
+        return;
+      }
+      index = next_chunk_++;
+    }
+
+    if (!video) {
+      video.reset(new FFMPEGVideo(filename_, filter_descr_, options_));
+      video->SetKeyframeIndex(keyframes_, frame_timestamps_);
+    }
+    bool decoded = video->isInitialized() && decode_chunk(*video, index);
+    std::lock_guard<std::mutex> lock(mutex_);
+    Chunk &chunk = chunks_[index];
+    if (!decoded && !stopping_) {
+      std::cerr << "Failed to decode frames [" << chunk.start << ", "
+                << chunk.end << ") of " << filename_ << std::endl;
+      chunk.failed = true;
+      failed_chunks_++;
+    }
+    chunk.done = true;
+    changed_.notify_all();
+  }
+}
+
+// Decodes one chunk into its queue, waiting while the queue is full.
+bool ParallelVideo::decode_chunk(FFMPEGVideo &video, size_t index) {
+  int start, end;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    start = chunks_[index].start;
+    end = chunks_[index].end;
+  }
+  if (!video.SetFrameRange(start, end)) {
+    return false;
+  }
+  VideoFrame frame;
+  while (video.GetNextFrame(frame)) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    Chunk &chunk = chunks_[index];
+    changed_.wait(lock, [&] {
+      return stopping_ || chunk.frames.size() < queue_frames_;
+    });
+    if (stopping_) {
+      return false;
+    }
+    chunk.frames.push_back(std::move(frame));
+    buffered_++;
+    max_buffered_ = std::max(max_buffered_, buffered_);
+    changed_.notify_all();
+  }
+  // The index may overcount the last chunk by a frame or two.
+  return video.get_frame_id() >= end || index + 1 == chunks_.size();
+}
+
+// Getter implementations
+int ParallelVideo::get_workers() const { return workers_; }
+
+int ParallelVideo::get_chunks() const {
+  return static_cast<int>(chunks_.size());
+}
+
+int ParallelVideo::get_frame_total() const { return frame_total_; }
+
+int ParallelVideo::get_frame_id() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frame_id_;
+}
+
+size_t ParallelVideo::get_buffered() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return buffered_;
+}
+
+size_t ParallelVideo::get_max_buffered() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return max_buffered_;
+}
+
+int ParallelVideo::get_failed_chunks() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return failed_chunks_;
+}
@@ -0,0 +1,86 @@
+#ifndef PARALLEL_VIDEO_H
+#define PARALLEL_VIDEO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ffmpeg_video.h"
+
+// Decodes one long file with several FFMPEGVideo pipelines at once: the file
+// is split at keyframes into chunks, each worker thread decodes whole chunks
+// (demux, decode and filter) into a bounded per-chunk queue, and frames are
+// handed out chunk after chunk, i.e. in global order. Workers only run
+// ahead of the chunk being read by one chunk each, so at most
+// workers x queue_frames frames are buffered.
+class ParallelVideo {
+public:
+  // chunks 0 picks 4 per worker.
+  ParallelVideo(const std::string &filename,
+                const std::string &filter_descr_str,
+                const FFMPEGVideoOptions &options, int workers,
+                int chunks = 0, int queue_frames = 8);
+  ~ParallelVideo();
+
+  bool isInitialized() const;
+  // Returns the next frame in global order; false at the end of the file.
+  bool GetNextFrame(VideoFrame &output_frame);
+  void Stop();
+
+  // Getter methods
+  int get_workers() const;
+  int get_chunks() const;
+  int get_frame_total() const;
+  int get_frame_id() const; // Frames handed out so far
+  size_t get_buffered() const;
+  size_t get_max_buffered() const; // Peak of get_buffered()
+  int get_failed_chunks() const;
+
+private:
+  struct Chunk {
+    int start = 0;
+    int end = 0;
+    std::deque<VideoFrame> frames;
+    bool done = false;
+    bool failed = false;
+  };
+
+  const std::string filename_;
+  const std::string filter_descr_;
+  FFMPEGVideoOptions options_;
+  const size_t queue_frames_;
+  bool initialized_;
+  int workers_;
+  int frame_total_;
+
+  std::unique_ptr<FFMPEGVideo> probe_; // Splits the file, then worker 0's
+  // Index scanned by the probe, handed to the other workers
+  std::vector<KeyframeEntry> keyframes_;
+  std::vector<int64_t> frame_timestamps_;
+  std::vector<std::thread> threads_;
+  std::atomic<bool> stopping_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::vector<Chunk> chunks_;
+  size_t next_chunk_;   // Next chunk for a worker
+  size_t output_chunk_; // Chunk being read
+  size_t buffered_;
+  size_t max_buffered_;
+  int frame_id_;
+  int failed_chunks_;
+
+  // Worker thread body
+  void run(std::unique_ptr<FFMPEGVideo> video);
+  bool decode_chunk(FFMPEGVideo &video, size_t index);
+};
+
+#endif // PARALLEL_VIDEO_H
@@ -0,0 +1,126 @@
+#include "session_governor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// SessionTicket Class Implementation
+SessionTicket::SessionTicket(HwSessionGovernor &governor)
+    : governor_(governor) {}
+
+SessionTicket::~SessionTicket() { governor_.release(); }
+
+// HwSessionGovernor Class Implementation
+bool HwSessionGovernor::WaiterOrder::operator()(const Waiter &a,
+                                                const Waiter &b) const {
+  if (*policy == SessionQueuePolicy::Priority && a.priority != b.priority) {
+    return a.priority > b.priority;
+  }
+  return a.seq < b.seq;
+}
+
+HwSessionGovernor::HwSessionGovernor()
+    : max_sessions_(0), policy_(SessionQueuePolicy::Fifo),
+      govern_software_(false), next_seq_(0),
+      waiters_(WaiterOrder{&policy_}) {}
+
+HwSessionGovernor &HwSessionGovernor::instance() {
+  static HwSessionGovernor governor;
+  return governor;
+}
+
+void HwSessionGovernor::configure(int max_sessions, SessionQueuePolicy policy,
+                                  bool govern_software) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_sessions_ = std::max(max_sessions, 0);
+  govern_software_ = govern_software;
+  if (policy != policy_) {
+    // Re-sort the queued opens under the new order.
+    std::vector<Waiter> waiters(waiters_.begin(), waiters_.end());
+    waiters_.clear();
+    policy_ = policy;
+    waiters_.insert(waiters.begin(), waiters.end());
+  }
+  stats_.max_sessions = max_sessions_;
+  session_freed_.notify_all();
+}
+
+std::unique_ptr<SessionTicket> HwSessionGovernor::Acquire(int priority,
+                                                          int timeout_ms) {
+  auto start = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(mutex_);
+  // Waiters are looked up by value, the set is rebuilt if the policy changes.
+  Waiter waiter{priority, next_seq_++};
+  waiters_.insert(waiter);
+  stats_.waiting = static_cast<int>(waiters_.size());
+
+  auto ready = [&] {
+    return waiters_.begin()->seq == waiter.seq &&
+           (max_sessions_ == 0 || stats_.active < max_sessions_);
+  };
+  bool granted;
+  if (timeout_ms < 0) {
+    session_freed_.wait(lock, ready);
+    granted = true;
+  } else {
+    granted = session_freed_.wait_for(
+        lock, std::chrono::milliseconds(timeout_ms), ready);
+  }
+
+  waiters_.erase(waiter);
+  stats_.waiting = static_cast<int>(waiters_.size());
+  double wait_ms = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  stats_.wait_total_ms += wait_ms;
+  stats_.wait_max_ms = std::max(stats_.wait_max_ms, wait_ms);
+  // The head of the queue changed, let the next waiter re-check.
+  session_freed_.notify_all();
+
+  if (!granted) {
+    if (timeout_ms != 0) {
+      stats_.timeouts++; // A zero timeout is only a probe
+    }
+    return nullptr;
+  }
+  stats_.active++;
+  stats_.peak_active = std::max(stats_.peak_active, stats_.active);
+  stats_.granted++;
+  return std::unique_ptr<SessionTicket>(new SessionTicket(*this));
+}
+
+void HwSessionGovernor::release() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.active--;
+  session_freed_.notify_all();
+}
+
+void HwSessionGovernor::record_fallback() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.fallbacks++;
+}
+
+void HwSessionGovernor::record_hw_open_failure() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.hw_open_failures++;
+}
+
+bool HwSessionGovernor::governs_software() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return govern_software_;
+}
+
+SessionGovernorStats HwSessionGovernor::get_stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void HwSessionGovernor::reset_stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SessionGovernorStats stats;
+  stats.max_sessions = max_sessions_;
+  stats.active = stats_.active;
+  stats.peak_active = stats_.active;
+  stats.waiting = stats_.waiting;
+  stats_ = stats;
+}
@@ -0,0 +1,94 @@
+#ifndef SESSION_GOVERNOR_H
+#define SESSION_GOVERNOR_H
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
+
+// Order in which queued decoder opens are granted a session.
+enum class SessionQueuePolicy {
+  Fifo,    // First come, first served
+  Priority // Highest priority first, FIFO among equals
+};
+
+struct SessionGovernorStats {
+  int max_sessions = 0; // 0 means unlimited
+  int active = 0;
+  int peak_active = 0;
+  int waiting = 0;
+  uint64_t granted = 0;
+  uint64_t timeouts = 0;
+  uint64_t fallbacks = 0;        // Readers that fell back to software
+  uint64_t hw_open_failures = 0; // Sessions granted, yet the HW open failed
+  double wait_total_ms = 0.0;
+  double wait_max_ms = 0.0;
+};
+
+class HwSessionGovernor;
+
+// A granted decoder session, returned to the governor on destruction.
+class SessionTicket {
+public:
+  ~SessionTicket();
+  SessionTicket(const SessionTicket &) = delete;
+  SessionTicket &operator=(const SessionTicket &) = delete;
+
+private:
+  friend class HwSessionGovernor;
+  explicit SessionTicket(HwSessionGovernor &governor);
+  HwSessionGovernor &governor_;
+};
+
+// Process-wide cap on concurrent hardware (MPP/RGA) decoder sessions. Opens
+// beyond the cap queue up instead of failing inside av_hwdevice_ctx_create()
+// or avcodec_open2().
+class HwSessionGovernor {
+public:
+  static HwSessionGovernor &instance();
+
+  // max_sessions <= 0 disables the cap. With govern_software, software
+  // decoders take sessions too, which allows exercising the governor on
+  // machines without the hardware.
+  void configure(int max_sessions, SessionQueuePolicy policy,
+                 bool govern_software = false);
+  // Waits up to timeout_ms (-1 waits forever) for a session. Returns null
+  // on timeout; a timeout_ms of 0 is a probe and is not counted as one.
+  std::unique_ptr<SessionTicket> Acquire(int priority, int timeout_ms);
+
+  void record_fallback();
+  void record_hw_open_failure();
+
+  // Getter methods
+  bool governs_software() const;
+  SessionGovernorStats get_stats() const;
+  void reset_stats();
+
+private:
+  friend class SessionTicket;
+
+  struct Waiter {
+    int priority;
+    uint64_t seq;
+  };
+  struct WaiterOrder {
+    const SessionQueuePolicy *policy;
+    bool operator()(const Waiter &a, const Waiter &b) const;
+  };
+
+  HwSessionGovernor();
+  void release();
+
+  mutable std::mutex mutex_;
+  std::condition_variable session_freed_;
+  int max_sessions_;
+  SessionQueuePolicy policy_;
+  bool govern_software_;
+  uint64_t next_seq_;
+  std::set<Waiter, WaiterOrder> waiters_; // Head is served next
+  SessionGovernorStats stats_;
+};
+
+#endif // SESSION_GOVERNOR_H
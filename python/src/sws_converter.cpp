@@ -0,0 +1,92 @@
+#include "sws_converter.h"
+
+#include <iostream>
+#include <string>
+
+extern "C" {
+#include <libavutil/error.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include "av_error.h"
+
+// SwsConverter Class Implementation
+SwsConverter::SwsConverter(int width, int height, AVPixelFormat format,
+                           int threads)
+    : FrameConverter(width, height, format), threads_(threads),
+      sws_ctx_(nullptr), dst_range_(AVCOL_RANGE_UNSPECIFIED) {}
+
+SwsConverter::~SwsConverter() { sws_freeContext(sws_ctx_); }
+
+const char *SwsConverter::get_name() const { return "swscale"; }
+
+bool SwsConverter::convert(const AVFrame *src, AVFrame *dst) {
+  if (src->format == format_ && src->width == out_width_ &&
+      src->height == out_height_ && !letterboxed()) {
+    // Already in the output format (e.g. raw nv12), share the buffers.
+    return !check_error(av_frame_ref(dst, src), "Failed to reference frame");
+  }
+  if (!alloc_output(src, dst)) {
+    return false;
+  }
+  AVFrame *target = content_frame(dst);
+  if (!target) {
+    return false;
+  }
+  dst->color_range = dst_range_;
+  int ret = sws_scale_frame(sws_ctx_, target, src);
+  return !check_error(ret, "Failed to convert frame");
+}
+
+bool SwsConverter::configure(const AVFrame *src) {
+  // The deprecated yuvj formats are full range yuv.
+  AVPixelFormat src_format = static_cast<AVPixelFormat>(src->format);
+  bool full_range = src->color_range == AVCOL_RANGE_JPEG;
+  if (src_format == AV_PIX_FMT_YUVJ420P) {
+    src_format = AV_PIX_FMT_YUV420P;
+    full_range = true;
+  }
+
+  sws_freeContext(sws_ctx_);
+  sws_ctx_ = sws_alloc_context();
+  if (!sws_ctx_) {
+    std::cerr << "Failed to allocate SwsContext." << std::endl;
+    return false;
+  }
+  av_opt_set_int(sws_ctx_, "srcw", src->width, 0);
+  av_opt_set_int(sws_ctx_, "srch", src->height, 0);
+  av_opt_set_int(sws_ctx_, "src_format", src_format, 0);
+  av_opt_set_int(sws_ctx_, "dstw", out_width_, 0);
+  av_opt_set_int(sws_ctx_, "dsth", out_height_, 0);
+  av_opt_set_int(sws_ctx_, "dst_format", format_, 0);
+  av_opt_set_int(sws_ctx_, "sws_flags", SWS_BILINEAR, 0);
+  av_opt_set_int(sws_ctx_, "threads", threads_, 0);
+  int ret = sws_init_context(sws_ctx_, nullptr, nullptr);
+  if (check_error(ret, "Failed to initialize SwsContext")) {
+    sws_freeContext(sws_ctx_);
+    sws_ctx_ = nullptr;
+    return false;
+  }
+
+  // RGB is always full range. YUV and gray keep the source range, like
+  // the filter graph and the luma plane do.
+  bool dst_full_range = full_range;
+  if (av_pix_fmt_desc_get(format_)->flags & AV_PIX_FMT_FLAG_RGB) {
+    dst_full_range = true;
+  }
+  dst_range_ = dst_full_range ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+
+  int colorspace = src->colorspace == AVCOL_SPC_BT709 ? SWS_CS_ITU709
+                                                      : SWS_CS_DEFAULT;
+  sws_setColorspaceDetails(sws_ctx_, sws_getCoefficients(colorspace),
+                           full_range, sws_getCoefficients(SWS_CS_DEFAULT),
+                           dst_full_range, 0, 1 << 16, 1 << 16);
+#if !NDEBUG
+  std::cout << "SwsContext: " << src->width << "x" << src->height << " "
+            << av_get_pix_fmt_name(src_format) << " -> " << out_width_ << "x"
+            << out_height_ << " " << av_get_pix_fmt_name(format_)
+            << std::endl;
+#endif
+  return true;
+}
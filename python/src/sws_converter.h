@@ -0,0 +1,31 @@
+#ifndef SWS_CONVERTER_H
+#define SWS_CONVERTER_H
+
+#include "frame_converter.h"
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+// Resize and pixel format conversion with one cached SwsContext, slice
+// threaded. Skips the filter graph (buffersrc/buffersink and their extra
+// frame references).
+class SwsConverter : public FrameConverter {
+public:
+  // threads = 0 lets swscale pick the slice thread count.
+  SwsConverter(int width, int height, AVPixelFormat format, int threads);
+  ~SwsConverter() override;
+
+  const char *get_name() const override;
+
+protected:
+  bool configure(const AVFrame *src) override;
+  bool convert(const AVFrame *src, AVFrame *dst) override;
+
+private:
+  int threads_;
+  SwsContext *sws_ctx_;
+  AVColorRange dst_range_; // Range of the output, set by configure()
+};
+
+#endif // SWS_CONVERTER_H
@@ -0,0 +1,183 @@
+#include "tensor_writer.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+
+// float -> IEEE half, rounding to nearest even.
+static uint16_t float_to_half(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint32_t sign = (bits >> 16) & 0x8000;
+  uint32_t exponent = (bits >> 23) & 0xFF;
+  uint32_t mantissa = bits & 0x7FFFFF;
+  if (exponent == 0xFF) { // Inf, NaN
+    return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+  }
+
+  int half_exponent = static_cast<int>(exponent) - 127 + 15;
+  if (half_exponent >= 31) {
+    return sign | 0x7C00; // Overflow to Inf
+  }
+  int shift = 13;
+  uint32_t half;
+  if (half_exponent <= 0) { // Subnormal (or zero)
+    if (half_exponent < -10) {
+      return sign;
+    }
+    mantissa |= 0x800000;
+    shift = 14 - half_exponent;
+    half = mantissa >> shift;
+  } else {
+    half = (static_cast<uint32_t>(half_exponent) << 10) | (mantissa >> shift);
+  }
+  uint32_t rest = mantissa & ((1u << shift) - 1);
+  uint32_t midpoint = 1u << (shift - 1);
+  if (rest > midpoint || (rest == midpoint && (half & 1))) {
+    half++; // May carry into the exponent, which is still correct
+  }
+  return static_cast<uint16_t>(sign | half);
+}
+
+// TensorWriter Class Implementation
+TensorWriter::TensorWriter()
+    : chw_(true), rgb_(true), dtype_("float32"),
+      element_size_(sizeof(float)) {}
+
+bool TensorWriter::Init(const std::string &layout,
+                        const std::string &channel_order,
+                        const std::string &dtype,
+                        const std::vector<float> &mean,
+                        const std::vector<float> &scale) {
+  if (layout != "chw" && layout != "hwc") {
+    std::cerr << "Unknown tensor layout '" << layout << "' (chw or hwc)."
+              << std::endl;
+    return false;
+  }
+  if (channel_order != "rgb" && channel_order != "bgr") {
+    std::cerr << "Unknown tensor channel order '" << channel_order
+              << "' (rgb or bgr)." << std::endl;
+    return false;
+  }
+  if (dtype == "float32") {
+    element_size_ = sizeof(float);
+  } else if (dtype == "float16") {
+    element_size_ = sizeof(uint16_t);
+  } else if (dtype == "uint8") {
+    element_size_ = sizeof(uint8_t);
+  } else {
+    std::cerr << "Unknown tensor dtype '" << dtype
+              << "' (float32, float16 or uint8)." << std::endl;
+    return false;
+  }
+  if ((mean.size() != 1 && mean.size() != 3) ||
+      (scale.size() != 1 && scale.size() != 3)) {
+    std::cerr << "Tensor mean and scale take one or three values."
+              << std::endl;
+    return false;
+  }
+  chw_ = layout == "chw";
+  rgb_ = channel_order == "rgb";
+  dtype_ = dtype;
+
+  lut_.resize(3 * 256 * element_size_);
+  for (int c = 0; c < 3; c++) {
+    float channel_mean = mean[mean.size() == 3 ? c : 0];
+    float channel_scale = scale[scale.size() == 3 ? c : 0];
+    for (int x = 0; x < 256; x++) {
+      float value = (x - channel_mean) * channel_scale;
+      int i = c * 256 + x;
+      if (dtype_ == "float32") {
+        reinterpret_cast<float *>(lut_.data())[i] = value;
+      } else if (dtype_ == "float16") {
+        reinterpret_cast<uint16_t *>(lut_.data())[i] = float_to_half(value);
+      } else {
+        lut_[i] = static_cast<uint8_t>(
+            std::min(std::max(std::lround(value), 0L), 255L));
+      }
+    }
+  }
+  return true;
+}
+
+bool TensorWriter::get_shape(const AVFrame *src,
+                             std::vector<int64_t> &shape) const {
+  int channels;
+  switch (src->format) {
+  case AV_PIX_FMT_GRAY8:
+    channels = 1;
+    break;
+  case AV_PIX_FMT_BGR24:
+  case AV_PIX_FMT_RGB24:
+    channels = 3;
+    break;
+  default:
+    std::cerr << "Tensor output needs gray, bgr24 or rgb24 frames."
+              << std::endl;
+    return false;
+  }
+  if (chw_) {
+    shape = {channels, src->height, src->width};
+  } else {
+    shape = {src->height, src->width, channels};
+  }
+  return true;
+}
+
+template <typename T>
+void TensorWriter::write_frame(const AVFrame *src, int channels, bool swap,
+                               T *dst) const {
+  const T *lut = reinterpret_cast<const T *>(lut_.data());
+  int width = src->width;
+  size_t plane_size = static_cast<size_t>(width) * src->height;
+  for (int y = 0; y < src->height; y++) {
+    const uint8_t *row =
+        src->data[0] + static_cast<ptrdiff_t>(y) * src->linesize[0];
+    if (chw_) {
+      for (int c = 0; c < channels; c++) {
+        const uint8_t *in = row + (swap ? 2 - c : c);
+        const T *table = lut + c * 256;
+        T *out = dst + c * plane_size + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; x++) {
+          out[x] = table[in[x * channels]];
+        }
+      }
+    } else {
+      T *out = dst + static_cast<size_t>(y) * width * channels;
+      for (int x = 0; x < width; x++) {
+        for (int c = 0; c < channels; c++) {
+          out[x * channels + c] =
+              lut[c * 256 + row[x * channels + (swap ? 2 - c : c)]];
+        }
+      }
+    }
+  }
+}
+
+bool TensorWriter::Write(const AVFrame *src, void *dst) const {
+  std::vector<int64_t> shape;
+  if (!get_shape(src, shape)) {
+    return false;
+  }
+  int channels = src->format == AV_PIX_FMT_GRAY8 ? 1 : 3;
+  bool swap = channels == 3 && rgb_ != (src->format == AV_PIX_FMT_RGB24);
+  if (element_size_ == sizeof(float)) {
+    write_frame(src, channels, swap, static_cast<float *>(dst));
+  } else if (element_size_ == sizeof(uint16_t)) {
+    write_frame(src, channels, swap, static_cast<uint16_t *>(dst));
+  } else {
+    write_frame(src, channels, swap, static_cast<uint8_t *>(dst));
+  }
+  return true;
+}
+
+// Getter implementations
+const std::string &TensorWriter::get_dtype() const { return dtype_; }
+
+size_t TensorWriter::get_element_size() const { return element_size_; }
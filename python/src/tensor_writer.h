@@ -0,0 +1,51 @@
+#ifndef TENSOR_WRITER_H
+#define TENSOR_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+// Writes gray/bgr24/rgb24 frames as ML input tensors in a single pass:
+// HWC or CHW layout, RGB or BGR channel order, uint8, float16 or float32
+// elements holding (x - mean) * scale per channel. The per-channel math is
+// folded into 256-entry lookup tables, so the pass is one load and store per
+// element whatever the dtype.
+class TensorWriter {
+public:
+  TensorWriter();
+
+  // mean and scale hold one value for all channels or one per channel (in
+  // the requested channel order).
+  bool Init(const std::string &layout, const std::string &channel_order,
+            const std::string &dtype, const std::vector<float> &mean,
+            const std::vector<float> &scale);
+
+  // Shape of the tensor for src, (C, H, W) or (H, W, C). Returns false for
+  // unsupported formats.
+  bool get_shape(const AVFrame *src, std::vector<int64_t> &shape) const;
+  // Writes src into dst, a C-contiguous buffer of get_shape() elements.
+  bool Write(const AVFrame *src, void *dst) const;
+
+  // Getter methods
+  const std::string &get_dtype() const; // NumPy dtype name
+  size_t get_element_size() const;
+
+private:
+  bool chw_;
+  bool rgb_;
+  std::string dtype_;
+  size_t element_size_;
+  std::vector<uint8_t> lut_; // 3 x 256 elements of the output dtype
+
+  template <typename T>
+  void write_frame(const AVFrame *src, int channels, bool swap,
+                   T *dst) const;
+};
+
+#endif // TENSOR_WRITER_H
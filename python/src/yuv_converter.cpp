@@ -0,0 +1,641 @@
+#include "yuv_converter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+static YuvCoeffs make_coeffs(bool bt709, bool full_range) {
+  double kr = bt709 ? 0.2126 : 0.299;
+  double kb = bt709 ? 0.0722 : 0.114;
+  double kg = 1.0 - kr - kb;
+  // Limited range stretches Y from 16..235 and UV from 16..240.
+  double y_scale = full_range ? 1.0 : 255.0 / 219.0;
+  double c_scale = full_range ? 64.0 : 64.0 * 255.0 / 224.0;
+
+  YuvCoeffs coeffs;
+  coeffs.y_offset = full_range ? 0 : 16;
+  coeffs.y_coef = static_cast<int16_t>(std::lround(y_scale * 64.0));
+  coeffs.rv = static_cast<int16_t>(std::lround(2.0 * (1.0 - kr) * c_scale));
+  coeffs.gu = static_cast<int16_t>(
+      std::lround(2.0 * (1.0 - kb) * kb / kg * c_scale));
+  coeffs.gv = static_cast<int16_t>(
+      std::lround(2.0 * (1.0 - kr) * kr / kg * c_scale));
+  coeffs.bu = static_cast<int16_t>(std::lround(2.0 * (1.0 - kb) * c_scale));
+  return coeffs;
+}
+
+static inline uint8_t clamp_pixel(int value) {
+  // Matches the saturating 16-bit SIMD arithmetic after the final shift.
+  value = std::min(std::max(value, -32768), 32767) >> 6;
+  return static_cast<uint8_t>(std::min(std::max(value, 0), 255));
+}
+
+// Scalar row kernel, from pixel x_start (even) on. Also the tail of the SIMD
+// kernels.
+static void yuv_row_scalar_from(const uint8_t *y, const uint8_t *u,
+                                const uint8_t *v, int uv_step, uint8_t *dst,
+                                int x_start, int width,
+                                const YuvCoeffs &coeffs, bool swap_rb) {
+  for (int x = x_start; x < width; x++) {
+    int uc = u[(x >> 1) * uv_step] - 128;
+    int vc = v[(x >> 1) * uv_step] - 128;
+    int yy = (y[x] - coeffs.y_offset) * coeffs.y_coef + 32;
+    uint8_t r = clamp_pixel(yy + coeffs.rv * vc);
+    uint8_t g = clamp_pixel(yy - (coeffs.gu * uc + coeffs.gv * vc));
+    uint8_t b = clamp_pixel(yy + coeffs.bu * uc);
+    dst[3 * x] = swap_rb ? r : b;
+    dst[3 * x + 1] = g;
+    dst[3 * x + 2] = swap_rb ? b : r;
+  }
+}
+
+static void yuv_row_scalar(const uint8_t *y, const uint8_t *u,
+                           const uint8_t *v, int uv_step, uint8_t *dst,
+                           int width, const YuvCoeffs &coeffs, bool swap_rb) {
+  yuv_row_scalar_from(y, u, v, uv_step, dst, 0, width, coeffs, swap_rb);
+}
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+// 16 pixels per iteration. uv_step 2 reads interleaved UV (NV12) at u.
+static void yuv_row_neon(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+                         int uv_step, uint8_t *dst, int width,
+                         const YuvCoeffs &coeffs, bool swap_rb) {
+  const int16x8_t y_offset = vdupq_n_s16(coeffs.y_offset);
+  const int16x8_t rounding = vdupq_n_s16(32);
+  const uint8x8_t bias = vdup_n_u8(128);
+
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    uint8x8_t u8, v8;
+    if (uv_step == 2) {
+      uint8x8x2_t uv = vld2_u8(u + x);
+      u8 = uv.val[0];
+      v8 = uv.val[1];
+    } else {
+      u8 = vld1_u8(u + x / 2);
+      v8 = vld1_u8(v + x / 2);
+    }
+    int16x8_t uc = vreinterpretq_s16_u16(vsubl_u8(u8, bias));
+    int16x8_t vc = vreinterpretq_s16_u16(vsubl_u8(v8, bias));
+    int16x8_t r_c = vmulq_n_s16(vc, coeffs.rv);
+    int16x8_t g_c = vmlaq_n_s16(vmulq_n_s16(uc, coeffs.gu), vc, coeffs.gv);
+    int16x8_t b_c = vmulq_n_s16(uc, coeffs.bu);
+
+    uint8x16_t y8 = vld1q_u8(y + x);
+    int16x8_t y_lo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(y8)));
+    int16x8_t y_hi = vreinterpretq_s16_u16(vmovl_high_u8(y8));
+    y_lo = vaddq_s16(vmulq_n_s16(vsubq_s16(y_lo, y_offset), coeffs.y_coef),
+                     rounding);
+    y_hi = vaddq_s16(vmulq_n_s16(vsubq_s16(y_hi, y_offset), coeffs.y_coef),
+                     rounding);
+
+    // Each chroma sample covers two neighbouring pixels.
+    uint8x16_t r = vcombine_u8(
+        vqshrun_n_s16(vqaddq_s16(y_lo, vzip1q_s16(r_c, r_c)), 6),
+        vqshrun_n_s16(vqaddq_s16(y_hi, vzip2q_s16(r_c, r_c)), 6));
+    uint8x16_t g = vcombine_u8(
+        vqshrun_n_s16(vqsubq_s16(y_lo, vzip1q_s16(g_c, g_c)), 6),
+        vqshrun_n_s16(vqsubq_s16(y_hi, vzip2q_s16(g_c, g_c)), 6));
+    uint8x16_t b = vcombine_u8(
+        vqshrun_n_s16(vqaddq_s16(y_lo, vzip1q_s16(b_c, b_c)), 6),
+        vqshrun_n_s16(vqaddq_s16(y_hi, vzip2q_s16(b_c, b_c)), 6));
+
+    uint8x16x3_t pixels;
+    pixels.val[0] = swap_rb ? r : b;
+    pixels.val[1] = g;
+    pixels.val[2] = swap_rb ? b : r;
+    vst3q_u8(dst + 3 * x, pixels);
+  }
+  yuv_row_scalar_from(y, u, v, uv_step, dst, x, width, coeffs, swap_rb);
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) static inline __m128i
+pack_u8_avx2(__m256i value) {
+  // packus works per 128-bit lane, keep the low quadword of each.
+  __m256i packed = _mm256_packus_epi16(value, value);
+  return _mm256_castsi256_si128(_mm256_permute4x64_epi64(packed, 0x08));
+}
+
+// 16 pixels per iteration. uv_step 2 reads interleaved UV (NV12) at u.
+__attribute__((target("avx2"))) static void
+yuv_row_avx2(const uint8_t *y, const uint8_t *u, const uint8_t *v,
+             int uv_step, uint8_t *dst, int width, const YuvCoeffs &coeffs,
+             bool swap_rb) {
+  const __m256i y_offset = _mm256_set1_epi16(coeffs.y_offset);
+  const __m256i y_coef = _mm256_set1_epi16(coeffs.y_coef);
+  const __m256i rounding = _mm256_set1_epi16(32);
+  const __m256i bias = _mm256_set1_epi16(128);
+  const __m256i rv = _mm256_set1_epi16(coeffs.rv);
+  const __m256i gu = _mm256_set1_epi16(coeffs.gu);
+  const __m256i gv = _mm256_set1_epi16(coeffs.gv);
+  const __m256i bu = _mm256_set1_epi16(coeffs.bu);
+  const __m256i low_half = _mm256_set1_epi32(0x0000FFFF);
+  // Interleaves three 16 byte planes into 48 bytes of packed pixels.
+  const __m128i shuffle[3][3] = {
+      {_mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5),
+       _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1),
+       _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4,
+                     -1)},
+      {_mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10,
+                     -1),
+       _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1,
+                     10),
+       _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1,
+                     -1)},
+      {_mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15,
+                     -1, -1),
+       _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1,
+                     15, -1),
+       _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1,
+                     -1, 15)}};
+
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m256i uc, vc;
+    if (uv_step == 2) {
+      // 32-bit lanes hold (u, v), duplicate each into both halves.
+      __m256i uv = _mm256_cvtepu8_epi16(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(u + x)));
+      uc = _mm256_or_si256(_mm256_and_si256(uv, low_half),
+                           _mm256_slli_epi32(uv, 16));
+      vc = _mm256_or_si256(_mm256_srli_epi32(uv, 16),
+                           _mm256_andnot_si256(low_half, uv));
+    } else {
+      __m128i u8 =
+          _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x / 2));
+      __m128i v8 =
+          _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + x / 2));
+      uc = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(u8, u8));
+      vc = _mm256_cvtepu8_epi16(_mm_unpacklo_epi8(v8, v8));
+    }
+    uc = _mm256_sub_epi16(uc, bias);
+    vc = _mm256_sub_epi16(vc, bias);
+
+    __m256i yy = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x)));
+    yy = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_sub_epi16(yy, y_offset), y_coef), rounding);
+
+    __m256i r = _mm256_srai_epi16(
+        _mm256_adds_epi16(yy, _mm256_mullo_epi16(vc, rv)), 6);
+    __m256i g = _mm256_srai_epi16(
+        _mm256_subs_epi16(yy, _mm256_add_epi16(_mm256_mullo_epi16(uc, gu),
+                                               _mm256_mullo_epi16(vc, gv))),
+        6);
+    __m256i b = _mm256_srai_epi16(
+        _mm256_adds_epi16(yy, _mm256_mullo_epi16(uc, bu)), 6);
+
+    __m128i planes[3] = {pack_u8_avx2(swap_rb ? r : b), pack_u8_avx2(g),
+                         pack_u8_avx2(swap_rb ? b : r)};
+    for (int k = 0; k < 3; k++) {
+      __m128i out = _mm_or_si128(
+          _mm_or_si128(_mm_shuffle_epi8(planes[0], shuffle[k][0]),
+                       _mm_shuffle_epi8(planes[1], shuffle[k][1])),
+          _mm_shuffle_epi8(planes[2], shuffle[k][2]));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 3 * x + 16 * k),
+                       out);
+    }
+  }
+  yuv_row_scalar_from(y, u, v, uv_step, dst, x, width, coeffs, swap_rb);
+}
+#endif
+
+static YuvRowKernel pick_row_kernel(const char **name) {
+#if defined(__aarch64__) && defined(__ARM_NEON)
+  *name = "neon";
+  return yuv_row_neon;
+#elif defined(__x86_64__) || defined(__i386__)
+  if (__builtin_cpu_supports("avx2")) {
+    *name = "avx2";
+    return yuv_row_avx2;
+  }
+#endif
+  *name = "scalar";
+  return yuv_row_scalar;
+}
+
+static const char *row_kernel_name = nullptr;
+static const YuvRowKernel row_kernel = pick_row_kernel(&row_kernel_name);
+
+// Averages the 2x2 blocks of two rows: out[i] from columns 2i and 2i + 1.
+typedef void (*HalveRowKernel)(const uint8_t *row0, const uint8_t *row1,
+                               uint8_t *dst, int out_width);
+
+static void halve_row_scalar_from(const uint8_t *row0, const uint8_t *row1,
+                                  uint8_t *dst, int i_start, int out_width) {
+  for (int i = i_start; i < out_width; i++) {
+    int sum = row0[2 * i] + row0[2 * i + 1] + row1[2 * i] + row1[2 * i + 1];
+    dst[i] = static_cast<uint8_t>((sum + 2) >> 2);
+  }
+}
+
+static void halve_row_scalar(const uint8_t *row0, const uint8_t *row1,
+                             uint8_t *dst, int out_width) {
+  halve_row_scalar_from(row0, row1, dst, 0, out_width);
+}
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+static void halve_row_neon(const uint8_t *row0, const uint8_t *row1,
+                           uint8_t *dst, int out_width) {
+  int i = 0;
+  for (; i + 16 <= out_width; i += 16) {
+    uint16x8_t lo = vpaddlq_u8(vld1q_u8(row0 + 2 * i));
+    lo = vpadalq_u8(lo, vld1q_u8(row1 + 2 * i));
+    uint16x8_t hi = vpaddlq_u8(vld1q_u8(row0 + 2 * i + 16));
+    hi = vpadalq_u8(hi, vld1q_u8(row1 + 2 * i + 16));
+    vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2)));
+  }
+  halve_row_scalar_from(row0, row1, dst, i, out_width);
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) static void
+halve_row_avx2(const uint8_t *row0, const uint8_t *row1, uint8_t *dst,
+               int out_width) {
+  const __m256i ones = _mm256_set1_epi8(1);
+  const __m256i rounding = _mm256_set1_epi16(2);
+  int i = 0;
+  for (; i + 16 <= out_width; i += 16) {
+    __m256i a = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(row0 + 2 * i));
+    __m256i b = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(row1 + 2 * i));
+    // maddubs with ones adds horizontal byte pairs into 16-bit lanes.
+    __m256i sum = _mm256_add_epi16(_mm256_maddubs_epi16(a, ones),
+                                   _mm256_maddubs_epi16(b, ones));
+    sum = _mm256_srli_epi16(_mm256_add_epi16(sum, rounding), 2);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+                     pack_u8_avx2(sum));
+  }
+  halve_row_scalar_from(row0, row1, dst, i, out_width);
+}
+#endif
+
+static HalveRowKernel pick_halve_kernel() {
+#if defined(__aarch64__) && defined(__ARM_NEON)
+  return halve_row_neon;
+#elif defined(__x86_64__) || defined(__i386__)
+  if (__builtin_cpu_supports("avx2")) {
+    return halve_row_avx2;
+  }
+#endif
+  return halve_row_scalar;
+}
+
+static const HalveRowKernel halve_kernel = pick_halve_kernel();
+
+// Averages rows [r0, r1) over the column boxes [x0[i], x1[i]) of a plane.
+static void area_row(const uint8_t *plane, int stride, int step, int r0,
+                     int r1, int width, const int *x0, const int *x1, int n,
+                     uint32_t *col_sums, uint8_t *out) {
+  std::fill(col_sums, col_sums + width, 0);
+  for (int r = r0; r < r1; r++) {
+    const uint8_t *row = plane + static_cast<ptrdiff_t>(r) * stride;
+    for (int x = 0; x < width; x++) {
+      col_sums[x] += row[x * step];
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    uint32_t sum = 0;
+    for (int x = x0[i]; x < x1[i]; x++) {
+      sum += col_sums[x];
+    }
+    uint32_t count = (x1[i] - x0[i]) * (r1 - r0);
+    out[i] = static_cast<uint8_t>((sum + count / 2) / count);
+  }
+}
+
+// Interpolates between two rows at the columns x0/x1 with 8-bit weights.
+static void bilinear_row(const uint8_t *row0, const uint8_t *row1, int wy,
+                         int step, const int *x0, const int *x1,
+                         const int *wx, int n, uint8_t *out) {
+  for (int i = 0; i < n; i++) {
+    int top = row0[x0[i] * step] * (256 - wx[i]) + row0[x1[i] * step] * wx[i];
+    int bottom =
+        row1[x0[i] * step] * (256 - wx[i]) + row1[x1[i] * step] * wx[i];
+    out[i] = static_cast<uint8_t>((top * (256 - wy) + bottom * wy + 32768) >>
+                                  16);
+  }
+}
+
+// Sample position of an output coordinate, for bilinear filtering.
+static void bilinear_tap(double pos, int size, int &p0, int &p1, int &w) {
+  pos = std::max(pos, 0.0);
+  p0 = std::min(static_cast<int>(pos), size - 1);
+  p1 = std::min(p0 + 1, size - 1);
+  w = static_cast<int>((pos - p0) * 256.0);
+  w = std::min(std::max(w, 0), 256);
+}
+
+// Sampling of output position i along one axis: the box [p0, p1) for area,
+// or the two taps and the weight of p1 for bilinear.
+static void axis_taps(bool bilinear, int src_size, int out_size, int i,
+                      int &p0, int &p1, int &w) {
+  if (bilinear) {
+    double scale = static_cast<double>(src_size) / out_size;
+    bilinear_tap((i + 0.5) * scale - 0.5, src_size, p0, p1, w);
+    return;
+  }
+  p0 = static_cast<int>(static_cast<int64_t>(i) * src_size / out_size);
+  p1 = std::max(
+      static_cast<int>(static_cast<int64_t>(i + 1) * src_size / out_size),
+      p0 + 1);
+  w = 0;
+}
+
+// YuvConverter Class Implementation
+YuvConverter::YuvConverter(int width, int height, AVPixelFormat format,
+                           bool bilinear)
+    : FrameConverter(width, height, format), bilinear_(bilinear),
+      coeffs_(make_coeffs(true, true)), uv_step_(1),
+      region_(av_frame_alloc()) {}
+
+YuvConverter::~YuvConverter() { av_frame_free(&region_); }
+
+bool YuvConverter::ConvertRegion(const AVFrame *src, int x, int y, int width,
+                                 int height, uint8_t *dst, int dst_linesize) {
+  if (!region_) {
+    return false;
+  }
+  // The region only borrows the plane pointers of src.
+  int uv_step = src->format == AV_PIX_FMT_NV12 ? 2 : 1;
+  region_->format = src->format;
+  region_->width = width;
+  region_->height = height;
+  region_->color_range = src->color_range;
+  region_->colorspace = src->colorspace;
+  if (src->colorspace == AVCOL_SPC_UNSPECIFIED) {
+    // Guess from the full frame, not the region size.
+    region_->colorspace =
+        src->height >= 720 ? AVCOL_SPC_BT709 : AVCOL_SPC_SMPTE170M;
+  }
+  region_->data[0] =
+      src->data[0] + static_cast<ptrdiff_t>(y) * src->linesize[0] + x;
+  region_->data[1] = src->data[1] +
+                     static_cast<ptrdiff_t>(y / 2) * src->linesize[1] +
+                     (x / 2) * uv_step;
+  region_->data[2] =
+      uv_step == 2 ? nullptr
+                   : src->data[2] +
+                         static_cast<ptrdiff_t>(y / 2) * src->linesize[2] +
+                         x / 2;
+  for (int i = 0; i < 3; i++) {
+    region_->linesize[i] = src->linesize[i];
+  }
+
+  get_output_size(width, height, out_width_, out_height_);
+  if (!configure(region_)) {
+    return false;
+  }
+  convert_rows(region_, dst, dst_linesize);
+  return true;
+}
+
+const char *YuvConverter::get_name() const { return "simd"; }
+
+const char *YuvConverter::get_kernel_name() { return row_kernel_name; }
+
+bool YuvConverter::configure(const AVFrame *src) {
+  AVPixelFormat src_format = static_cast<AVPixelFormat>(src->format);
+  if (src_format != AV_PIX_FMT_NV12 && src_format != AV_PIX_FMT_YUV420P &&
+      src_format != AV_PIX_FMT_YUVJ420P) {
+    std::cerr << "The simd converter reads NV12 or YUV420P frames, not "
+              << av_get_pix_fmt_name(src_format) << "." << std::endl;
+    return false;
+  }
+  if (format_ != AV_PIX_FMT_BGR24 && format_ != AV_PIX_FMT_RGB24) {
+    std::cerr << "The simd converter writes bgr24 or rgb24 only."
+              << std::endl;
+    return false;
+  }
+  uv_step_ = src_format == AV_PIX_FMT_NV12 ? 2 : 1;
+
+  // Untagged streams: HD and up is BT.709 in practice.
+  bool bt709 = src->colorspace == AVCOL_SPC_BT709 ||
+               (src->colorspace == AVCOL_SPC_UNSPECIFIED && src->height >= 720);
+  bool full_range = src->color_range == AVCOL_RANGE_JPEG ||
+                    src_format == AV_PIX_FMT_YUVJ420P;
+  coeffs_ = make_coeffs(bt709, full_range);
+
+  // Sampling tables for the fused resize (unused at the source size).
+  int src_width = src->width;
+  int chroma_width = (src->width + 1) / 2;
+  int pairs = (out_width_ + 1) / 2;
+  y_x0_.resize(out_width_);
+  y_x1_.resize(out_width_);
+  y_wx_.resize(out_width_);
+  c_x0_.resize(pairs);
+  c_x1_.resize(pairs);
+  c_wx_.resize(pairs);
+  for (int i = 0; i < out_width_; i++) {
+    axis_taps(bilinear_, src_width, out_width_, i, y_x0_[i], y_x1_[i],
+              y_wx_[i]);
+  }
+  double x_scale = static_cast<double>(src_width) / out_width_;
+  for (int i = 0; i < pairs; i++) {
+    // The pair covers output pixels 2i and 2i + 1.
+    if (bilinear_) {
+      double center = (2 * i + 1) * x_scale;
+      bilinear_tap(center / 2 - 0.5, chroma_width, c_x0_[i], c_x1_[i],
+                   c_wx_[i]);
+    } else {
+      int last = std::min(2 * i + 1, out_width_ - 1);
+      c_x0_[i] = y_x0_[2 * i] / 2;
+      c_x1_[i] = std::min((y_x1_[last] + 1) / 2, chroma_width);
+    }
+  }
+  col_sums_.resize(std::max(src_width, 1));
+  y_row_.resize(out_width_);
+  u_row_.resize(pairs);
+  v_row_.resize(pairs);
+#if !NDEBUG
+  std::cout << "YuvConverter (" << row_kernel_name << "): " << src->width
+            << "x" << src->height << " " << av_get_pix_fmt_name(src_format)
+            << (bt709 ? " bt709" : " bt601") << (full_range ? " pc" : " tv")
+            << " -> " << out_width_ << "x" << out_height_ << " "
+            << av_get_pix_fmt_name(format_) << std::endl;
+#endif
+  return true;
+}
+
+bool YuvConverter::convert(const AVFrame *src, AVFrame *dst) {
+  if (!alloc_output(src, dst)) {
+    return false;
+  }
+  AVFrame *target = content_frame(dst);
+  if (!target) {
+    return false;
+  }
+  convert_rows(src, target->data[0], target->linesize[0]);
+  return true;
+}
+
+void YuvConverter::convert_rows(const AVFrame *src, uint8_t *dst,
+                                int dst_linesize) {
+  bool swap_rb = format_ == AV_PIX_FMT_RGB24;
+  bool resize = out_width_ != src->width || out_height_ != src->height;
+  const uint8_t *u_plane = src->data[1];
+  const uint8_t *v_plane = uv_step_ == 2 ? src->data[1] + 1 : src->data[2];
+  int v_stride = uv_step_ == 2 ? src->linesize[1] : src->linesize[2];
+
+  for (int out_y = 0; out_y < out_height_; out_y++) {
+    uint8_t *out = dst + static_cast<ptrdiff_t>(out_y) * dst_linesize;
+    if (resize) {
+      resample_row(src, out_y);
+      row_kernel(y_row_.data(), u_row_.data(), v_row_.data(), 1, out,
+                 out_width_, coeffs_, swap_rb);
+    } else {
+      int chroma_y = out_y / 2;
+      row_kernel(src->data[0] +
+                     static_cast<ptrdiff_t>(out_y) * src->linesize[0],
+                 u_plane + static_cast<ptrdiff_t>(chroma_y) * src->linesize[1],
+                 v_plane + static_cast<ptrdiff_t>(chroma_y) * v_stride,
+                 uv_step_, out, out_width_, coeffs_, swap_rb);
+    }
+  }
+}
+
+// Fills y_row_/u_row_/v_row_ with the resampled planes of one output row.
+void YuvConverter::resample_row(const AVFrame *src, int out_y) {
+  int src_height = src->height;
+  int chroma_width = (src->width + 1) / 2;
+  int chroma_height = (src->height + 1) / 2;
+  int pairs = static_cast<int>(u_row_.size());
+  const uint8_t *u_plane = src->data[1];
+  const uint8_t *v_plane = uv_step_ == 2 ? src->data[1] + 1 : src->data[2];
+  int u_stride = src->linesize[1];
+  int v_stride = uv_step_ == 2 ? src->linesize[1] : src->linesize[2];
+
+  if (bilinear_) {
+    double y_scale = static_cast<double>(src_height) / out_height_;
+    double pos = (out_y + 0.5) * y_scale;
+    int r0, r1, wy;
+    bilinear_tap(pos - 0.5, src_height, r0, r1, wy);
+    bilinear_row(src->data[0] + static_cast<ptrdiff_t>(r0) * src->linesize[0],
+                 src->data[0] + static_cast<ptrdiff_t>(r1) * src->linesize[0],
+                 wy, 1, y_x0_.data(), y_x1_.data(), y_wx_.data(), out_width_,
+                 y_row_.data());
+    bilinear_tap(pos / 2 - 0.5, chroma_height, r0, r1, wy);
+    bilinear_row(u_plane + static_cast<ptrdiff_t>(r0) * u_stride,
+                 u_plane + static_cast<ptrdiff_t>(r1) * u_stride, wy,
+                 uv_step_, c_x0_.data(), c_x1_.data(), c_wx_.data(), pairs,
+                 u_row_.data());
+    bilinear_row(v_plane + static_cast<ptrdiff_t>(r0) * v_stride,
+                 v_plane + static_cast<ptrdiff_t>(r1) * v_stride, wy,
+                 uv_step_, c_x0_.data(), c_x1_.data(), c_wx_.data(), pairs,
+                 v_row_.data());
+    return;
+  }
+
+  int r0, r1, wy;
+  axis_taps(false, src_height, out_height_, out_y, r0, r1, wy);
+  area_row(src->data[0], src->linesize[0], 1, r0, r1, src->width,
+           y_x0_.data(), y_x1_.data(), out_width_, col_sums_.data(),
+           y_row_.data());
+  int c0 = r0 / 2;
+  int c1 = std::min((r1 + 1) / 2, chroma_height);
+  area_row(u_plane, u_stride, uv_step_, c0, c1, chroma_width, c_x0_.data(),
+           c_x1_.data(), pairs, col_sums_.data(), u_row_.data());
+  area_row(v_plane, v_stride, uv_step_, c0, c1, chroma_width, c_x0_.data(),
+           c_x1_.data(), pairs, col_sums_.data(), v_row_.data());
+}
+
+// LumaConverter Class Implementation
+LumaConverter::LumaConverter(int width, int height, bool bilinear)
+    : FrameConverter(width, height, AV_PIX_FMT_GRAY8), bilinear_(bilinear),
+      halve_(false) {}
+
+const char *LumaConverter::get_name() const { return "luma"; }
+
+bool LumaConverter::configure(const AVFrame *src) {
+  // Any format whose first plane is plain 8-bit luma (NV12, YUV420P, ...).
+  AVPixelFormat src_format = static_cast<AVPixelFormat>(src->format);
+  const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(src_format);
+  if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_PAL |
+                               AV_PIX_FMT_FLAG_HWACCEL)) ||
+      desc->comp[0].plane != 0 || desc->comp[0].step != 1 ||
+      desc->comp[0].offset != 0 || desc->comp[0].depth != 8) {
+    std::cerr << "The luma converter needs 8-bit YUV frames, not "
+              << av_get_pix_fmt_name(src_format) << "." << std::endl;
+    return false;
+  }
+
+  halve_ = !bilinear_ && src->width == 2 * out_width_ &&
+           src->height == 2 * out_height_;
+  x0_.resize(out_width_);
+  x1_.resize(out_width_);
+  wx_.resize(out_width_);
+  for (int i = 0; i < out_width_; i++) {
+    axis_taps(bilinear_, src->width, out_width_, i, x0_[i], x1_[i], wx_[i]);
+  }
+  col_sums_.resize(std::max(src->width, 1));
+#if !NDEBUG
+  std::cout << "LumaConverter: " << src->width << "x" << src->height << " "
+            << av_get_pix_fmt_name(src_format) << " -> " << out_width_ << "x"
+            << out_height_
+            << (out_width_ == src->width && out_height_ == src->height
+                    ? " (zero-copy)"
+                    : "")
+            << std::endl;
+#endif
+  return true;
+}
+
+bool LumaConverter::convert(const AVFrame *src, AVFrame *dst) {
+  if (out_width_ == src->width && out_height_ == src->height &&
+      !letterboxed()) {
+    // The luma plane is the output, share the source buffers.
+    if (av_frame_ref(dst, src) < 0) {
+      std::cerr << "Failed to reference frame. Out of memory?" << std::endl;
+      return false;
+    }
+    for (int i = 1; i < AV_NUM_DATA_POINTERS; i++) {
+      dst->data[i] = nullptr;
+      dst->linesize[i] = 0;
+    }
+    dst->format = AV_PIX_FMT_GRAY8;
+    return true;
+  }
+
+  if (!alloc_output(src, dst)) {
+    return false;
+  }
+  AVFrame *target = content_frame(dst);
+  if (!target) {
+    return false;
+  }
+  const uint8_t *plane = src->data[0];
+  int stride = src->linesize[0];
+  for (int out_y = 0; out_y < out_height_; out_y++) {
+    uint8_t *out = target->data[0] + static_cast<ptrdiff_t>(out_y) *
+                                         target->linesize[0];
+    int r0, r1, wy;
+    axis_taps(bilinear_, src->height, out_height_, out_y, r0, r1, wy);
+    if (halve_) {
+      halve_kernel(plane + static_cast<ptrdiff_t>(r0) * stride,
+                   plane + static_cast<ptrdiff_t>(r0 + 1) * stride, out,
+                   out_width_);
+    } else if (bilinear_) {
+      bilinear_row(plane + static_cast<ptrdiff_t>(r0) * stride,
+                   plane + static_cast<ptrdiff_t>(r1) * stride, wy, 1,
+                   x0_.data(), x1_.data(), wx_.data(), out_width_, out);
+    } else {
+      area_row(plane, stride, 1, r0, r1, src->width, x0_.data(), x1_.data(),
+               out_width_, col_sums_.data(), out);
+    }
+  }
+  return true;
+}
@@ -0,0 +1,91 @@
+#ifndef YUV_CONVERTER_H
+#define YUV_CONVERTER_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "frame_converter.h"
+
+// 6-bit fixed point YUV -> RGB coefficients for one matrix and range.
+struct YuvCoeffs {
+  int16_t y_offset;
+  int16_t y_coef;
+  int16_t rv; // R += rv * V
+  int16_t gu; // G -= gu * U + gv * V
+  int16_t gv;
+  int16_t bu; // B += bu * U
+};
+
+// Converts one 4:2:0 row to packed 24-bit pixels (B, G, R order, or R, G, B
+// with swap_rb). Chroma sample i is at u[i * uv_step] / v[i * uv_step] and
+// covers pixels 2i and 2i + 1.
+typedef void (*YuvRowKernel)(const uint8_t *y, const uint8_t *u,
+                             const uint8_t *v, int uv_step, uint8_t *dst,
+                             int width, const YuvCoeffs &coeffs,
+                             bool swap_rb);
+
+// NV12/YUV420P to BGR24/RGB24 with NEON (aarch64) or AVX2 (x86, picked at
+// runtime) row kernels and a scalar fallback, all bit-exact to each other.
+// BT.601/BT.709 and limited/full range follow the frame. A resize is fused
+// into the same pass: each output row is area averaged (or bilinearly
+// sampled) into a small row buffer right before the row kernel runs.
+class YuvConverter : public FrameConverter {
+public:
+  YuvConverter(int width, int height, AVPixelFormat format, bool bilinear);
+  ~YuvConverter() override;
+
+  // Converts the region (x, y, width, height) of an NV12/YUV420P frame,
+  // resized to the output size, into packed pixels at dst (crops). x and y
+  // must be even. Use an instance either for this or for Convert().
+  bool ConvertRegion(const AVFrame *src, int x, int y, int width,
+                     int height, uint8_t *dst, int dst_linesize);
+
+  const char *get_name() const override;
+
+  // The row kernel picked for this CPU ("neon", "avx2" or "scalar").
+  static const char *get_kernel_name();
+
+protected:
+  bool configure(const AVFrame *src) override;
+  bool convert(const AVFrame *src, AVFrame *dst) override;
+
+private:
+  bool bilinear_;
+  YuvCoeffs coeffs_;
+  int uv_step_; // 2 for NV12, 1 for planar
+
+  // Per output column (luma) and pixel pair (chroma) sampling tables:
+  // box [x0, x1) for area, or x0, x1 and weight for bilinear.
+  std::vector<int> y_x0_, y_x1_, y_wx_;
+  std::vector<int> c_x0_, c_x1_, c_wx_;
+  std::vector<uint32_t> col_sums_; // Area: column sums of the current rows
+  std::vector<uint8_t> y_row_, u_row_, v_row_;
+  AVFrame *region_; // View of the ConvertRegion() source area
+
+  void convert_rows(const AVFrame *src, uint8_t *dst, int dst_linesize);
+  void resample_row(const AVFrame *src, int out_y);
+};
+
+// 8-bit gray output straight from the luma plane of YUV frames. At the
+// source size the output references the decoded (or downloaded) frame, no
+// copy. Downscales by exactly 2 use a SIMD 2x2 box kernel, other sizes the
+// same area/bilinear sampling as YuvConverter.
+class LumaConverter : public FrameConverter {
+public:
+  LumaConverter(int width, int height, bool bilinear);
+
+  const char *get_name() const override;
+
+protected:
+  bool configure(const AVFrame *src) override;
+  bool convert(const AVFrame *src, AVFrame *dst) override;
+
+private:
+  bool bilinear_;
+  bool halve_; // Exact 2x downscale
+  std::vector<int> x0_, x1_, wx_;
+  std::vector<uint32_t> col_sums_;
+};
+
+#endif // YUV_CONVERTER_H